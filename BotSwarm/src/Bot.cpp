@@ -0,0 +1,471 @@
+#include "Bot.h"
+
+#include "Log.h"
+#include "MathUtils.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+// how often a bot re-syncs its clock with the server, each sync is a round trip measurement
+static const float SYNC_INTERVAL = 1.0f;
+// shooters fire as fast as a player who never runs out of ammo could
+static const float SHOOT_INTERVAL = RELOAD_TIME;
+static const float PLACE_INTERVAL = 0.5f;
+// the furthest either side of straight ahead a shooter aims (degrees)
+static const float MAX_AIM_SPREAD = 30.0f;
+
+
+const char* BotBehaviourToStr(BotBehaviour behaviour)
+{
+	switch (behaviour)
+	{
+	case BotBehaviour::Walker:	return "Walker";
+	case BotBehaviour::Shooter:	return "Shooter";
+	case BotBehaviour::Builder:	return "Builder";
+	default:					return "Unknown";
+	}
+}
+
+
+Bot::Bot(unsigned int index, BotBehaviour behaviour, bool readyUp, BotStats& stats)
+	: m_Index(index), m_Behaviour(behaviour), m_ReadyUp(readyUp), m_Stats(stats),
+	m_Automover(0.37f * index), m_Random(index)
+{
+	m_TcpSocket.setBlocking(false);
+	m_UdpSocket.setBlocking(false);
+}
+
+void Bot::Connect(const sf::IpAddress& address, unsigned short port)
+{
+	m_ServerAddress = address;
+	m_ServerPort = port;
+
+	if (m_UdpSocket.bind(sf::Socket::AnyPort) != sf::Socket::Done)
+	{
+		LOG_ERROR("Bot {} failed to bind a udp socket", m_Index);
+		m_State = State::Failed;
+		return;
+	}
+
+	// the socket is non-blocking, so this returns straight away and the connection completes in the background
+	auto status = m_TcpSocket.connect(m_ServerAddress, m_ServerPort);
+	if (status == sf::Socket::Error || status == sf::Socket::Disconnected)
+	{
+		m_State = State::Failed;
+		return;
+	}
+
+	m_State = State::Connecting;
+}
+
+void Bot::Disconnect()
+{
+	if (m_State != State::Connected)
+	{
+		if (m_State == State::Connecting) m_TcpSocket.disconnect();
+		if (m_State == State::Idle || m_State == State::Connecting) m_State = State::Finished;
+		return;
+	}
+
+	// the server acknowledges by disconnecting us
+	SendMessageTcp(MessageCode::Disconnect);
+	ProcessOutgoingTcp();
+	m_State = State::Finished;
+}
+
+void Bot::Update(float dt)
+{
+	m_LocalTime += dt;
+	m_SimulationTime += dt;
+
+	if (m_State == State::Connecting)
+	{
+		ProcessIncomingTcp();
+		return;
+	}
+
+	if (m_State == State::Finished)
+	{
+		// keep sending whatever was queued before we asked to disconnect
+		if (HasQueuedTcp()) ProcessOutgoingTcp();
+		return;
+	}
+
+	if (m_State != State::Connected) return;
+
+	ProcessIncomingUdp();
+	ProcessIncomingTcp();
+	if (m_State != State::Connected) return;
+
+	Move(dt);
+
+	// send periodic updates to the server
+	m_UpdateTimer += dt;
+	if (m_UpdateTimer > UPDATE_FREQUENCY)
+	{
+		m_UpdateTimer -= UPDATE_FREQUENCY;
+		SendUpdate();
+	}
+
+	// measure the round trip to the server, and stay in sync with its clock
+	m_SyncTimer += dt;
+	if (m_SyncTimer > SYNC_INTERVAL && !m_SyncInFlight)
+	{
+		m_SyncTimer = 0.0f;
+		m_SyncInFlight = true;
+		m_SyncSentAt = m_LocalTime;
+		SendMessageTcp(MessageCode::GetServerTime);
+	}
+
+	// ready up whenever we're in the lobby, so that games keep starting
+	if (m_ReadyUp && m_GameState == GameState::Lobby && !m_GameStartRequested)
+	{
+		m_GameStartRequested = true;
+		SendMessageTcp(MessageCode::GameStart);
+	}
+
+	m_ActionTimer += dt;
+	if (m_Behaviour == BotBehaviour::Shooter && m_GameState == GameState::FightMode && m_ActionTimer > SHOOT_INTERVAL)
+	{
+		m_ActionTimer = 0.0f;
+		Shoot();
+	}
+	else if (m_Behaviour == BotBehaviour::Builder && m_GameState == GameState::BuildMode && m_ActionTimer > PLACE_INTERVAL && m_BlocksLeft > 0)
+	{
+		m_ActionTimer = 0.0f;
+		PlaceBlock();
+	}
+
+	ProcessOutgoingTcp();
+}
+
+void Bot::ProcessIncomingTcp()
+{
+	// receive everything that has arrived
+	while (m_State == State::Connecting || m_State == State::Connected)
+	{
+		auto status = m_TcpSocket.receive(m_ReceivePacket);
+		if (status == sf::Socket::Done)
+		{
+			m_Stats.tcpMessagesReceived++;
+			m_Stats.bytesReceived += m_ReceivePacket.getDataSize();
+
+			PacketReader packet{ m_ReceivePacket };
+			MessageHeader header;
+			packet >> header;
+
+			if (m_State == State::Connecting)
+			{
+				if (header.messageCode != MessageCode::Connect) continue;
+
+				if (header.clientID == INVALID_CLIENT_ID)
+				{
+					// the server is full
+					m_State = State::Rejected;
+					m_TcpSocket.disconnect();
+					return;
+				}
+
+				OnConnect(header, packet);
+				continue;
+			}
+
+			// the rest of the game is of no interest to a bot
+			switch (header.messageCode)
+			{
+			case MessageCode::Disconnect:			OnConnectionLost();			return;
+			case MessageCode::GetServerTime:		OnServerTime(packet);		break;
+			case MessageCode::Shoot:				OnShoot(packet);			break;
+			case MessageCode::ShootRequestDenied:	m_Stats.shootsDenied++; OnRequestAnswered();	break;
+			case MessageCode::Place:				OnPlace(packet);			break;
+			case MessageCode::PlaceRequestDenied:	m_Stats.placesDenied++; OnRequestAnswered();	break;
+			case MessageCode::ChangeGameState:		OnChangeGameState(packet);	break;
+			case MessageCode::ChangeTeam:			OnChangeTeam(packet);		break;
+			case MessageCode::PlayerDeath:			GoToSpawn();				break;
+			case MessageCode::GameStart:
+				m_GameState = GameState::BuildMode;
+				m_BlocksLeft = INITIAL_BUILD_MODE_BLOCKS;
+				m_GameStartRequested = false;
+				GoToSpawn();
+				break;
+			default:								break;
+			}
+		}
+		else if (status == sf::Socket::NotReady || status == sf::Socket::Partial)
+		{
+			// nothing left to receive
+			return;
+		}
+		else
+		{
+			// this is also how a refused connection shows up while connecting
+			OnConnectionLost();
+			return;
+		}
+	}
+}
+
+void Bot::ProcessIncomingUdp()
+{
+	sf::IpAddress fromAddr;
+	unsigned short fromPort;
+	while (m_UdpSocket.receive(m_ReceivePacket, fromAddr, fromPort) == sf::Socket::Done)
+	{
+		// only the server is allowed to send us updates
+		if (fromAddr != m_ServerAddress || fromPort != m_ServerPort) continue;
+
+		m_Stats.udpMessagesReceived++;
+		m_Stats.bytesReceived += m_ReceivePacket.getDataSize();
+
+		PacketReader packet{ m_ReceivePacket };
+		MessageHeader header;
+		packet >> header;
+		if (!packet || header.clientID != m_ClientID) continue;
+
+		if (header.messageCode == MessageCode::Update)
+		{
+			// the players themselves don't matter, but acknowledging the snapshot makes the server delta-encode like it would for a real client
+			SnapshotHeader snapshotHeader;
+			packet >> snapshotHeader;
+			if (!packet || snapshotHeader.sequence == NO_SNAPSHOT) continue;
+
+			if (m_LatestSnapshot == NO_SNAPSHOT || SequenceMoreRecent(snapshotHeader.sequence, m_LatestSnapshot))
+				m_LatestSnapshot = snapshotHeader.sequence;
+			m_Stats.snapshots++;
+		}
+		else if (header.messageCode == MessageCode::Ping)
+		{
+			// answer straight away so the server measures the network, not the bot
+			PingMessage ping;
+			packet >> ping;
+			if (!packet) continue;
+
+			m_SendPacket.Clear();
+			m_SendPacket << MessageHeader{ m_ClientID, MessageCode::Ping } << ping;
+			SendPacketUdp(m_SendPacket);
+			m_Stats.pings++;
+		}
+	}
+}
+
+void Bot::ProcessOutgoingTcp()
+{
+	// send as much of the queued tcp data as the socket will take
+	auto status = m_TcpSendQueue.Flush(m_TcpSocket);
+	if (status == sf::Socket::Error || status == sf::Socket::Disconnected)
+		OnConnectionLost();
+}
+
+void Bot::Move(float dt)
+{
+	m_Position += m_Automover.Step(dt);
+
+	// blocks can't be placed in spawn, so builders walk out of it first
+	if (m_Behaviour == BotBehaviour::Builder && m_GameState == GameState::BuildMode)
+	{
+		float buildLine = SPAWN_WIDTH + 2.0f * BLOCK_SIZE;
+		if (m_Team == PlayerTeam::Red && m_Position.x < buildLine)
+			m_Position.x = std::min(m_Position.x + dt * PLAYER_MOVE_SPEED, buildLine);
+		else if (m_Team == PlayerTeam::Blue && m_Position.x > WORLD_WIDTH - buildLine)
+			m_Position.x = std::max(m_Position.x - dt * PLAYER_MOVE_SPEED, WORLD_WIDTH - buildLine);
+	}
+
+	// stay inside the world
+	m_Position.x = Clamp(m_Position.x, PLAYER_SIZE, WORLD_WIDTH - PLAYER_SIZE);
+	m_Position.y = Clamp(m_Position.y, PLAYER_SIZE, WORLD_HEIGHT - PLAYER_SIZE);
+}
+
+void Bot::SendUpdate()
+{
+	// calculate the time difference since the last update was sent
+	float dt = std::max(0.0f, m_SimulationTime - m_LastUpdateTime);
+	m_LastUpdateTime = m_SimulationTime;
+
+	UpdateMessage update
+	{
+		m_ClientID,
+		m_Position.x, m_Position.y,
+		m_Rotation,
+		dt,
+		m_SimulationTime,
+		m_LatestSnapshot,
+		m_UpdateSequence++
+	};
+
+	m_SendPacket.Clear();
+	m_SendPacket << MessageHeader{ m_ClientID, MessageCode::Update } << update;
+	SendPacketUdp(m_SendPacket);
+}
+
+void Bot::Shoot()
+{
+	// aim roughly towards the other team's side
+	std::uniform_real_distribution<float> spread(-MAX_AIM_SPREAD, MAX_AIM_SPREAD);
+	float angle = DegToRad(spread(m_Random)) + (m_Team == PlayerTeam::Red ? 0.0f : 3.14159265f);
+	sf::Vector2f direction{ std::cos(angle), std::sin(angle) };
+	m_Rotation = RadToDeg(angle);
+
+	ShootMessage shootMessage
+	{
+		INVALID_PROJECTILE_ID, // will be assigned by server
+		m_ClientID,
+		m_Team,
+		m_Position.x, m_Position.y,
+		direction.x, direction.y,
+		m_SimulationTime
+	};
+	SendMessageTcp(MessageCode::Shoot, shootMessage);
+
+	m_Stats.shootRequests++;
+	m_RequestsSentAt.push(m_LocalTime);
+}
+
+void Bot::PlaceBlock()
+{
+	// a couple of blocks towards the turf line, close enough for the server to allow it
+	float forward = (m_Team == PlayerTeam::Red ? 1.0f : -1.0f) * 2.0f * BLOCK_SIZE;
+	std::uniform_int_distribution<int> offset(-1, 1);
+	sf::Vector2f position{ m_Position.x + forward, m_Position.y + offset(m_Random) * BLOCK_SIZE };
+
+	PlaceMessage placeMessage
+	{
+		INVALID_BLOCK_ID, // will be assigned by server
+		m_ClientID,
+		m_Team,
+		position.x, position.y
+	};
+	SendMessageTcp(MessageCode::Place, placeMessage);
+
+	m_Stats.placeRequests++;
+	m_RequestsSentAt.push(m_LocalTime);
+	m_BlocksLeft--;
+}
+
+void Bot::SendMessageTcp(MessageCode code)
+{
+	m_SendPacket.Clear();
+	m_SendPacket << MessageHeader{ m_ClientID, code };
+	SendPacketTcp(m_SendPacket);
+}
+
+void Bot::SendPacketTcp(PacketWriter& packet)
+{
+	m_Stats.tcpMessagesSent++;
+	m_Stats.bytesSent += packet.GetDataSize();
+
+	if (!m_TcpSendQueue.Push(packet))
+	{
+		// the server hasn't been accepting data for a long time
+		LOG_WARN("Bot {} has too much data waiting to be sent to the server, dropping it", m_Index);
+		OnConnectionLost();
+	}
+}
+
+void Bot::SendPacketUdp(const PacketWriter& packet)
+{
+	m_Stats.udpMessagesSent++;
+	m_Stats.bytesSent += packet.GetDataSize();
+
+	m_UdpSocket.send(packet.GetData(), packet.GetDataSize(), m_ServerAddress, m_ServerPort);
+}
+
+void Bot::OnConnect(const MessageHeader& header, PacketReader& packet)
+{
+	m_State = State::Connected;
+	m_ClientID = header.clientID;
+
+	ConnectMessage connectMessage;
+	packet >> connectMessage;
+
+	m_Team = connectMessage.team;
+	m_GameState = connectMessage.gameState;
+	m_BlocksLeft = m_GameState == GameState::BuildMode ? SUBSEQUENT_BUILD_MODE_BLOCKS : 0;
+	GoToSpawn();
+
+	// tell the server how to contact us via udp
+	IntroductionMessage introduction{ static_cast<sf::Uint16>(m_UdpSocket.getLocalPort()) };
+	SendMessageTcp(MessageCode::Introduction, introduction);
+
+	// the first sync goes out straight away
+	m_SyncTimer = SYNC_INTERVAL;
+}
+
+void Bot::OnServerTime(PacketReader& packet)
+{
+	ServerTimeMessage message;
+	packet >> message;
+
+	float roundTrip = m_LocalTime - m_SyncSentAt;
+	m_SyncInFlight = false;
+	m_Stats.syncRoundTrips.push_back(roundTrip);
+
+	// our simulation time is the server's time minus half the latency
+	m_SimulationTime = message.serverTime - 0.5f * roundTrip;
+}
+
+void Bot::OnShoot(PacketReader& packet)
+{
+	ShootMessage message;
+	packet >> message;
+
+	// everyone is told about every projectile, only our own answer a request
+	if (message.shotBy == m_ClientID) OnRequestAnswered();
+}
+
+void Bot::OnPlace(PacketReader& packet)
+{
+	PlaceMessage message;
+	packet >> message;
+
+	if (message.placedBy == m_ClientID) OnRequestAnswered();
+}
+
+void Bot::OnRequestAnswered()
+{
+	if (m_RequestsSentAt.empty()) return;
+
+	m_Stats.requestRoundTrips.push_back(m_LocalTime - m_RequestsSentAt.front());
+	m_RequestsSentAt.pop();
+}
+
+void Bot::OnChangeGameState(PacketReader& packet)
+{
+	ChangeGameStateMessage message;
+	packet >> message;
+
+	m_GameState = message.state;
+	if (m_GameState == GameState::Lobby)
+		m_GameStartRequested = false;
+	else if (m_GameState == GameState::BuildMode)
+		m_BlocksLeft = SUBSEQUENT_BUILD_MODE_BLOCKS;
+}
+
+void Bot::OnChangeTeam(PacketReader& packet)
+{
+	ChangeTeamMessage message;
+	packet >> message;
+
+	if (message.playerID == m_ClientID)
+	{
+		m_Team = message.team;
+		GoToSpawn();
+	}
+}
+
+void Bot::OnConnectionLost()
+{
+	if (m_State == State::Connected) m_Stats.disconnects++;
+
+	m_State = State::Failed;
+	m_TcpSocket.disconnect();
+	m_TcpSendQueue.Clear();
+}
+
+void Bot::GoToSpawn()
+{
+	if (m_Team == PlayerTeam::Red)
+		m_Position = { 0.5f * SPAWN_WIDTH, 0.5f * WORLD_HEIGHT };
+	else
+		m_Position = { WORLD_WIDTH - 0.5f * SPAWN_WIDTH, 0.5f * WORLD_HEIGHT };
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include "Network/NetworkTypes.h"
+#include "Network/Snapshot.h"
+#include "Network/TcpSendQueue.h"
+#include "Automover.h"
+
+#include <vector>
+#include <queue>
+#include <random>
+
+
+// what a bot does once it has joined a game
+// every bot moves and answers pings, these decide what else it asks the server for
+enum class BotBehaviour
+{
+	Walker,		// only moves around
+	Shooter,	// shoots at the other team during fight mode
+	Builder		// places blocks on its own turf during build mode
+};
+const char* BotBehaviourToStr(BotBehaviour behaviour);
+
+
+// counters shared by every bot in the swarm, reset after every report
+struct BotStats
+{
+	unsigned int tcpMessagesSent = 0;
+	unsigned int tcpMessagesReceived = 0;
+	unsigned int udpMessagesSent = 0;
+	unsigned int udpMessagesReceived = 0;
+	size_t bytesSent = 0;
+	size_t bytesReceived = 0;
+
+	unsigned int snapshots = 0;			// updates received from the server
+	unsigned int pings = 0;				// pings from the server that were answered
+
+	unsigned int shootRequests = 0;
+	unsigned int shootsDenied = 0;
+	unsigned int placeRequests = 0;
+	unsigned int placesDenied = 0;
+
+	// round trips of GetServerTime requests, which the server answers as soon as it reads them (seconds)
+	std::vector<float> syncRoundTrips;
+	// time from a bot sending a shoot/place request to the server confirming or denying it (seconds)
+	std::vector<float> requestRoundTrips;
+
+	unsigned int disconnects = 0;		// connected bots that lost their connection
+};
+
+
+// a headless client that speaks the same protocol as the real client
+class Bot
+{
+public:
+	enum class State
+	{
+		Idle,			// hasn't tried to connect yet
+		Connecting,		// tcp is connecting, or waiting for the server to give us a client ID
+		Connected,		// in a game
+		Rejected,		// the server was full
+		Failed,			// couldn't connect, or lost the connection
+		Finished		// disconnected when asked to
+	};
+
+public:
+	// the bot's movement starts at a different point of the automove pattern depending on its index
+	Bot(unsigned int index, BotBehaviour behaviour, bool readyUp, BotStats& stats);
+
+	// start connecting to the server, the connection completes during later updates
+	void Connect(const sf::IpAddress& address, unsigned short port);
+	// ask the server to disconnect us
+	void Disconnect();
+
+	void Update(float dt);
+
+	inline State GetState() const { return m_State; }
+	inline BotBehaviour GetBehaviour() const { return m_Behaviour; }
+	// there is still data waiting to go out
+	inline bool HasQueuedTcp() const { return !m_TcpSendQueue.Empty(); }
+
+private:
+	// process network traffic
+	void ProcessIncomingTcp();
+	void ProcessIncomingUdp();
+	void ProcessOutgoingTcp();
+
+	// behaviours
+	void Move(float dt);
+	void SendUpdate();
+	void Shoot();
+	void PlaceBlock();
+
+	// send to server
+	void SendMessageTcp(MessageCode code);
+	template<typename T>
+	void SendMessageTcp(MessageCode code, const T& message)
+	{
+		m_SendPacket.Clear();
+		m_SendPacket << MessageHeader{ m_ClientID, code } << message;
+		SendPacketTcp(m_SendPacket);
+	}
+	void SendPacketTcp(PacketWriter& packet);
+	void SendPacketUdp(const PacketWriter& packet);
+
+	// callbacks from messages
+	void OnConnect(const MessageHeader& header, PacketReader& packet);
+	void OnServerTime(PacketReader& packet);
+	void OnShoot(PacketReader& packet);
+	void OnPlace(PacketReader& packet);
+	void OnRequestAnswered();
+	void OnChangeGameState(PacketReader& packet);
+	void OnChangeTeam(PacketReader& packet);
+	void OnConnectionLost();
+
+	void GoToSpawn();
+
+private:
+	unsigned int m_Index;
+	BotBehaviour m_Behaviour;
+	bool m_ReadyUp;
+	BotStats& m_Stats;
+
+	State m_State = State::Idle;
+
+	sf::IpAddress m_ServerAddress = sf::IpAddress::None;
+	unsigned short m_ServerPort = 0;
+
+	sf::TcpSocket m_TcpSocket;
+	sf::UdpSocket m_UdpSocket;
+	PacketWriter m_SendPacket;
+	sf::Packet m_ReceivePacket;
+	TcpSendQueue m_TcpSendQueue{ TCP_SEND_QUEUE_SOFT_LIMIT, TCP_SEND_QUEUE_HARD_LIMIT };
+
+	ClientID m_ClientID = INVALID_CLIENT_ID;
+	PlayerTeam m_Team = PlayerTeam::None;
+	GameState m_GameState = GameState::Lobby;
+	bool m_GameStartRequested = false;
+
+	// the player
+	Automover m_Automover;
+	sf::Vector2f m_Position;
+	float m_Rotation = 0.0f;
+
+	// timers
+	// real time since the bot was created, for measuring round trips
+	float m_LocalTime = 0.0f;
+	// synchronised with the server, as the client does
+	float m_SimulationTime = 0.0f;
+	float m_LastUpdateTime = 0.0f;
+	float m_UpdateTimer = 0.0f;
+	float m_SyncTimer = 0.0f;
+	float m_ActionTimer = 0.0f;
+
+	// at most one time sync is in flight at once
+	bool m_SyncInFlight = false;
+	float m_SyncSentAt = 0.0f;
+	// shoot/place requests are answered in the order they were sent
+	std::queue<float> m_RequestsSentAt;
+
+	// the latest snapshot received, acknowledged in every update
+	SnapshotSequence m_LatestSnapshot = NO_SNAPSHOT;
+	// numbers every update, so the server can measure loss
+	sf::Uint16 m_UpdateSequence = 0;
+
+	unsigned int m_BlocksLeft = 0;
+
+	// seeded from the index, so that a run can be repeated
+	std::mt19937 m_Random;
+};
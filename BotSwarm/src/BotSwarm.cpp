@@ -0,0 +1,77 @@
+#include "SwarmApplication.h"
+#include "Log.h"
+
+#include <cstring>
+#include <cstdlib>
+
+
+static void PrintUsage()
+{
+	LOG_INFO("usage: BotSwarm [options]");
+	LOG_INFO("  --server <address>    server to connect to (default 127.0.0.1)");
+	LOG_INFO("  --port <port>         server port (default {})", SERVER_PORT);
+	LOG_INFO("  --bots <count>        number of bots (default 100)");
+	LOG_INFO("  --duration <seconds>  how long to run for (default 60)");
+	LOG_INFO("  --connect-rate <n>    bots connecting per second (default 50)");
+	LOG_INFO("  --tick-rate <hz>      how often the bots are updated (default 200)");
+	LOG_INFO("  --shooters <0-1>      fraction of bots that shoot (default 0.4)");
+	LOG_INFO("  --builders <0-1>      fraction of bots that place blocks (default 0.2)");
+	LOG_INFO("  --no-ready            don't ask for games to start, leaving the server in the lobby");
+	LOG_INFO("  --report <seconds>    how often to report (default 5)");
+}
+
+// returns false if the arguments couldn't be understood
+static bool ParseArguments(int argc, char** argv, SwarmConfig& config)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		// every option apart from --no-ready takes a value
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (std::strcmp(arg, "--no-ready") == 0)
+		{
+			config.readyUp = false;
+			continue;
+		}
+
+		if (!value) return false;
+		i++;
+
+		if (std::strcmp(arg, "--server") == 0)				config.serverAddress = sf::IpAddress(value);
+		else if (std::strcmp(arg, "--port") == 0)			config.serverPort = static_cast<unsigned short>(std::atoi(value));
+		else if (std::strcmp(arg, "--bots") == 0)			config.numBots = static_cast<unsigned int>(std::atoi(value));
+		else if (std::strcmp(arg, "--duration") == 0)		config.duration = static_cast<float>(std::atof(value));
+		else if (std::strcmp(arg, "--connect-rate") == 0)	config.connectRate = static_cast<float>(std::atof(value));
+		else if (std::strcmp(arg, "--tick-rate") == 0)		config.tickRate = static_cast<float>(std::atof(value));
+		else if (std::strcmp(arg, "--shooters") == 0)		config.shooterFraction = static_cast<float>(std::atof(value));
+		else if (std::strcmp(arg, "--builders") == 0)		config.builderFraction = static_cast<float>(std::atof(value));
+		else if (std::strcmp(arg, "--report") == 0)			config.reportInterval = static_cast<float>(std::atof(value));
+		else return false;
+	}
+
+	// sanity check the values
+	if (config.serverAddress == sf::IpAddress::None) return false;
+	if (config.connectRate <= 0.0f || config.tickRate <= 0.0f || config.reportInterval <= 0.0f) return false;
+	if (config.shooterFraction < 0.0f || config.builderFraction < 0.0f || config.shooterFraction + config.builderFraction > 1.0f) return false;
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	SwarmConfig config;
+	if (!ParseArguments(argc, argv, config))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	SwarmApplication* swarm = new SwarmApplication(config);
+	swarm->Run();
+	delete swarm;
+
+	return 0;
+}
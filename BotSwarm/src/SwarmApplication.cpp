@@ -0,0 +1,207 @@
+#include "SwarmApplication.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+
+// how long to keep sending once every bot has been asked to disconnect
+static const float SHUTDOWN_TIMEOUT = 2.0f;
+
+
+// the value below which the given fraction of samples fall
+// the samples are reordered
+static float Percentile(std::vector<float>& samples, float fraction)
+{
+	if (samples.empty()) return 0.0f;
+
+	size_t index = std::min(static_cast<size_t>(fraction * samples.size()), samples.size() - 1);
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index];
+}
+
+static void LogRoundTrips(const char* name, std::vector<float>& samples)
+{
+	if (samples.empty()) return;
+
+	float max = *std::max_element(samples.begin(), samples.end());
+	LOG_INFO("[{0}] {1} samples, p50: {2:.1f}ms, p90: {3:.1f}ms, p99: {4:.1f}ms, max: {5:.1f}ms",
+		name, samples.size(), 1000.0f * Percentile(samples, 0.5f), 1000.0f * Percentile(samples, 0.9f), 1000.0f * Percentile(samples, 0.99f), 1000.0f * max);
+}
+
+static void AddStats(BotStats& total, const BotStats& stats)
+{
+	total.tcpMessagesSent += stats.tcpMessagesSent;
+	total.tcpMessagesReceived += stats.tcpMessagesReceived;
+	total.udpMessagesSent += stats.udpMessagesSent;
+	total.udpMessagesReceived += stats.udpMessagesReceived;
+	total.bytesSent += stats.bytesSent;
+	total.bytesReceived += stats.bytesReceived;
+	total.snapshots += stats.snapshots;
+	total.pings += stats.pings;
+	total.shootRequests += stats.shootRequests;
+	total.shootsDenied += stats.shootsDenied;
+	total.placeRequests += stats.placeRequests;
+	total.placesDenied += stats.placesDenied;
+	total.syncRoundTrips.insert(total.syncRoundTrips.end(), stats.syncRoundTrips.begin(), stats.syncRoundTrips.end());
+	total.requestRoundTrips.insert(total.requestRoundTrips.end(), stats.requestRoundTrips.begin(), stats.requestRoundTrips.end());
+	total.disconnects += stats.disconnects;
+}
+
+
+SwarmApplication::SwarmApplication(const SwarmConfig& config)
+	: m_Config(config)
+{
+	// hand out behaviours in proportion, spread evenly through the swarm
+	unsigned int shooters = 0, builders = 0;
+	m_Bots.reserve(m_Config.numBots);
+	for (unsigned int i = 0; i < m_Config.numBots; i++)
+	{
+		BotBehaviour behaviour = BotBehaviour::Walker;
+		if (shooters < m_Config.shooterFraction * (i + 1))
+		{
+			behaviour = BotBehaviour::Shooter;
+			shooters++;
+		}
+		else if (builders < m_Config.builderFraction * (i + 1))
+		{
+			behaviour = BotBehaviour::Builder;
+			builders++;
+		}
+
+		m_Bots.push_back(new Bot(i, behaviour, m_Config.readyUp, m_Stats));
+	}
+
+	LOG_INFO("----Bot Swarm----");
+	LOG_INFO("Server: {0}:{1}", m_Config.serverAddress.toString(), m_Config.serverPort);
+	LOG_INFO("Bots: {0} ({1} shooters, {2} builders, {3} walkers)", m_Config.numBots, shooters, builders, m_Config.numBots - shooters - builders);
+	LOG_INFO("Connecting {0:.0f}/s, running for {1:.0f}s at {2:.0f}Hz", m_Config.connectRate, m_Config.duration, m_Config.tickRate);
+	LOG_INFO("-----------------");
+}
+
+SwarmApplication::~SwarmApplication()
+{
+	for (auto bot : m_Bots)
+		delete bot;
+}
+
+void SwarmApplication::Run()
+{
+	const sf::Time tick = sf::seconds(1.0f / m_Config.tickRate);
+
+	sf::Clock clock;
+	float time = 0.0f;
+	float connectTimer = 0.0f;
+	float reportTimer = 0.0f;
+	size_t nextBot = 0;
+
+	// the duration is measured from the first connection, and covers the time spent ramping up
+	while (time < m_Config.duration)
+	{
+		float lastTime = time;
+		time = clock.getElapsedTime().asSeconds();
+		float dt = time - lastTime;
+
+		// ramp up gradually
+		connectTimer += dt * m_Config.connectRate;
+		while (connectTimer >= 1.0f && nextBot < m_Bots.size())
+		{
+			m_Bots[nextBot++]->Connect(m_Config.serverAddress, m_Config.serverPort);
+			connectTimer -= 1.0f;
+		}
+		if (nextBot == m_Bots.size()) connectTimer = 0.0f;
+
+		for (auto bot : m_Bots)
+			bot->Update(dt);
+
+		reportTimer += dt;
+		if (reportTimer > m_Config.reportInterval)
+		{
+			Report(reportTimer);
+			reportTimer = 0.0f;
+		}
+
+		// sleep off whatever is left of the tick
+		sf::Time elapsed = clock.getElapsedTime() - sf::seconds(time);
+		if (elapsed < tick)
+			sf::sleep(tick - elapsed);
+	}
+
+	Report(reportTimer);
+	m_RunTime = time;
+	Shutdown();
+	LogStats(m_TotalStats, m_RunTime, true);
+}
+
+void SwarmApplication::Report(float interval)
+{
+	// everything is also added to the totals for the summary at the end
+	AddStats(m_TotalStats, m_Stats);
+	if (interval > 0.0f) LogStats(m_Stats, interval, false);
+	m_Stats = BotStats{};
+}
+
+void SwarmApplication::LogStats(BotStats& stats, float interval, bool final)
+{
+	// where every bot is up to
+	unsigned int states[static_cast<int>(Bot::State::Finished) + 1] = {};
+	for (auto bot : m_Bots)
+		states[static_cast<int>(bot->GetState())]++;
+
+	unsigned int connected = states[static_cast<int>(Bot::State::Connected)];
+	if (final)
+		LOG_INFO("====Summary ({0:.0f}s)====", interval);
+	else
+		LOG_INFO("----{0:.0f}s----", interval);
+	LOG_INFO("[Bots] connected: {0}, connecting: {1}, rejected: {2}, failed: {3}, lost connection: {4}",
+		connected, states[static_cast<int>(Bot::State::Connecting)], states[static_cast<int>(Bot::State::Rejected)],
+		states[static_cast<int>(Bot::State::Failed)], stats.disconnects);
+
+	LOG_INFO("[Rates] tcp out: {0:.1f}/s, tcp in: {1:.1f}/s, udp out: {2:.1f}/s, udp in: {3:.1f}/s, out: {4:.1f}KB/s, in: {5:.1f}KB/s",
+		stats.tcpMessagesSent / interval, stats.tcpMessagesReceived / interval, stats.udpMessagesSent / interval, stats.udpMessagesReceived / interval,
+		stats.bytesSent / interval / 1024.0f, stats.bytesReceived / interval / 1024.0f);
+
+	// a bot that is getting every snapshot sees one per UPDATE_FREQUENCY
+	if (connected > 0)
+	{
+		LOG_INFO("[Server] snapshots: {0:.1f}/s per bot (expected {1:.1f}), pings answered: {2:.2f}/s per bot",
+			stats.snapshots / interval / connected, 1.0f / UPDATE_FREQUENCY, stats.pings / interval / connected);
+	}
+
+	if (stats.shootRequests > 0 || stats.placeRequests > 0)
+	{
+		LOG_INFO("[Requests] shoot: {0} ({1} denied), place: {2} ({3} denied)",
+			stats.shootRequests, stats.shootsDenied, stats.placeRequests, stats.placesDenied);
+	}
+
+	LogRoundTrips("Sync RTT", stats.syncRoundTrips);
+	LogRoundTrips("Request RTT", stats.requestRoundTrips);
+}
+
+void SwarmApplication::Shutdown()
+{
+	LOG_INFO("Disconnecting bots...");
+	for (auto bot : m_Bots)
+		bot->Disconnect();
+
+	// anything that couldn't be sent straight away still needs to go out
+	sf::Clock clock;
+	float lastTime = 0.0f;
+	while (clock.getElapsedTime().asSeconds() < SHUTDOWN_TIMEOUT)
+	{
+		bool queued = false;
+		float time = clock.getElapsedTime().asSeconds();
+		for (auto bot : m_Bots)
+		{
+			bot->Update(time - lastTime);
+			queued |= bot->HasQueuedTcp();
+		}
+		lastTime = time;
+
+		if (!queued) break;
+		sf::sleep(sf::milliseconds(5));
+	}
+
+	// the last stretch hasn't been added to the totals yet
+	Report(0.0f);
+}
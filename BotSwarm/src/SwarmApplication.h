@@ -0,0 +1,55 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+
+#include "Bot.h"
+
+
+// how the swarm is set up, filled in from the command line
+struct SwarmConfig
+{
+	sf::IpAddress serverAddress = sf::IpAddress::LocalHost;
+	unsigned short serverPort = SERVER_PORT;
+
+	unsigned int numBots = 100;
+	float duration = 60.0f;			// seconds to run for once the first bot has connected
+	float connectRate = 50.0f;		// bots that start connecting per second, so the server isn't hit by every connection at once
+	float tickRate = 200.0f;		// how often every bot is updated
+
+	// the behaviour mix, whatever is left over are walkers
+	float shooterFraction = 0.4f;
+	float builderFraction = 0.2f;
+	// bots ask for the game to start so that the server runs full games, rather than sitting in the lobby
+	bool readyUp = true;
+
+	float reportInterval = 5.0f;
+};
+
+
+// drives many bots from a single thread and reports what they see
+class SwarmApplication
+{
+public:
+	explicit SwarmApplication(const SwarmConfig& config);
+	~SwarmApplication();
+
+	void Run();
+
+private:
+	// log everything the bots have counted since the last report
+	void Report(float interval);
+	void LogStats(BotStats& stats, float interval, bool final);
+	// disconnect every bot and give the disconnects a chance to reach the server
+	void Shutdown();
+
+private:
+	SwarmConfig m_Config;
+
+	std::vector<Bot*> m_Bots;
+	BotStats m_Stats;
+
+	// totals over the whole run
+	BotStats m_TotalStats;
+	float m_RunTime = 0.0f;
+};
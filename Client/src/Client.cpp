@@ -1,14 +1,18 @@
 #include "Core/ClientApplication.h"
 #include "Log.h"
+#include "Trace.h"
 
 
 int main()
 {
     Log::Init();
+    TRACE_THREAD_NAME("Main");
 
     ClientApplication* app = new ClientApplication;
     app->Run();
     delete app;
 
+    TRACE_FLUSH(CLIENT_TRACE_FILE);
+
     return 0;
 }
\ No newline at end of file
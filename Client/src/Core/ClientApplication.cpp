@@ -9,6 +9,7 @@
 
 #include "MathUtils.h"
 #include "Constants.h"
+#include "Trace.h"
 
 
 ClientApplication::ClientApplication()
@@ -56,6 +57,8 @@ void ClientApplication::Run()
 {
     while (m_Window.isOpen())
     {
+        TRACE_SCOPE("Frame");
+
         // calculate fps
         sf::Time deltaTime = m_Clock.restart();
         float dt = deltaTime.asSeconds();
@@ -112,7 +115,11 @@ void ClientApplication::Run()
         ImGui::End();
         ImGui::SFML::Render(m_Window);
 
-        m_Window.display();
+        {
+            // display waits for vsync, so it is traced on its own
+            TRACE_SCOPE("Display");
+            m_Window.display();
+        }
     }
 
 }
@@ -222,6 +229,8 @@ void ClientApplication::HandleInput(float dt)
 
 void ClientApplication::Update(float dt)
 {
+    TRACE_SCOPE("ClientApplication::Update");
+
     // update player indicator
     m_Indicator.setPosition(m_Player.getPosition());
     m_Indicator.Update();
@@ -276,6 +285,8 @@ void ClientApplication::Update(float dt)
 
 void ClientApplication::Render()
 {
+    TRACE_SCOPE("ClientApplication::Render");
+
     // fill with spawn colour
     m_Window.clear(DarkNoTeamColor);
 
@@ -310,6 +321,15 @@ void ClientApplication::GUI()
     // gui
     ImGui::Text("Application:");
     ImGui::Text("FPS: %0.1f", m_FPS);
+#ifdef ENABLE_TRACING
+    if (ImGui::Button("Save Trace"))
+    {
+        if (Trace::Flush(CLIENT_TRACE_FILE))
+            LOG_INFO("Trace written to {}", CLIENT_TRACE_FILE);
+        else
+            LOG_ERROR("Failed to write trace to {}", CLIENT_TRACE_FILE);
+    }
+#endif
 
     ImGui::Separator();
     ImGui::Text("Network:");
@@ -5,6 +5,7 @@
 
 #include "MathUtils.h"
 #include "Constants.h"
+#include "Automover.h"
 
 #include "imgui.h"
 
@@ -59,26 +60,7 @@ void ControllablePlayer::SettingsGUI()
 
 sf::Vector2f ControllablePlayer::Automove(float dt)
 {
-	// quick function to move the player in a semi random direction and to switch direction every so often
-	static float t = 0;
-	static float directionX = 0.0f;
-	static float directionY = 1.0f;
-	static float timerX = 2.0f;
-	static float timerY = 10.0f;
-
-	sf::Vector2f velocity{ dt * directionX * PLAYER_MOVE_SPEED, dt * directionY * PLAYER_MOVE_SPEED };
-
-	t += dt;
-	if (t > timerX)
-	{
-		timerX += 2.31f;
-		directionX = -directionX;
-	}
-	if (t > timerY)
-	{
-		timerY += 3.58f;
-		directionY = -directionY;
-	}
-
-	return velocity;
+	// move the player in a semi random direction, switching direction every so often
+	static Automover s_Automover;
+	return s_Automover.Step(dt);
 }
@@ -6,6 +6,11 @@
 #include "GameObjects\ControllablePlayer.h"
 #include "GameObjects\Projectile.h"
 #include "GameObjects\Block.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
 
 
 NetworkSystem::NetworkSystem()
@@ -77,6 +82,9 @@ void NetworkSystem::GUI()
 				if (ImGui::Button("Ready To Start")) RequestGameStart();
 			}
 		}
+
+		ImGui::Separator();
+		StatsGUI();
 	}
 	else
 	{
@@ -93,6 +101,8 @@ void NetworkSystem::GUI()
 
 void NetworkSystem::Update(float dt)
 {
+	TRACE_SCOPE("NetworkSystem::Update");
+
 	// update simulation time
 	m_SimulationTime += dt;
 
@@ -103,6 +113,7 @@ void NetworkSystem::Update(float dt)
 		ProcessIncomingUdp();
 		ProcessOutgoingUdp(dt);
 		ProcessIncomingTcp();
+		ProcessOutgoingTcp();
 
 		// update game state duration
 		if (m_RemainingGameStateDuration > 0.0f)
@@ -113,15 +124,22 @@ void NetworkSystem::Update(float dt)
 		// update all network players
 		for (auto& player : *m_NetworkPlayers)
 			player->Update(m_SimulationTime);
+
+		m_StatsTimer += dt;
+		if (m_StatsTimer >= CLIENT_STATS_SAMPLE_INTERVAL)
+		{
+			m_StatsTimer -= CLIENT_STATS_SAMPLE_INTERVAL;
+			SampleStats();
+		}
 	}
 	else if (m_ConnectionState == ConnectionState::Connecting)
 	{
 		// handle waiting for client ID
-		sf::Packet packet;
-		auto status = m_TcpSocket.receive(packet);
+		auto status = m_TcpSocket.receive(m_ReceivePacket);
 		if (status == sf::Socket::Done)
 		{
 			// received data
+			PacketReader packet{ m_ReceivePacket };
 			MessageHeader header;
 			packet >> header;
 
@@ -184,9 +202,11 @@ void NetworkSystem::Disconnect()
 
 	// request to disconnect from the server
 	MessageHeader header = CreateHeader(MessageCode::Disconnect);
-	sf::Packet packet;
-	packet << header;
-	SendPacketToServerTcp(packet);
+	m_SendPacket.Clear();
+	m_SendPacket << header;
+	SendPacketToServerTcp(m_SendPacket);
+	// this may be the last chance to send anything
+	ProcessOutgoingTcp();
 }
 
 void NetworkSystem::RequestGameStart()
@@ -195,9 +215,9 @@ void NetworkSystem::RequestGameStart()
 
 	// request for the game to start
 	MessageHeader header = CreateHeader(MessageCode::GameStart);
-	sf::Packet p;
-	p << header;
-	SendPacketToServerTcp(p);
+	m_SendPacket.Clear();
+	m_SendPacket << header;
+	SendPacketToServerTcp(m_SendPacket);
 
 	m_GameStartRequested = true;
 }
@@ -208,9 +228,9 @@ void NetworkSystem::RequestChangeTeam()
 
 	// request to change team
 	MessageHeader header = CreateHeader(MessageCode::ChangeTeam);
-	sf::Packet packet;
-	packet << header;
-	SendPacketToServerTcp(packet);
+	m_SendPacket.Clear();
+	m_SendPacket << header;
+	SendPacketToServerTcp(m_SendPacket);
 }
 
 void NetworkSystem::RequestShoot(const sf::Vector2f& position, const sf::Vector2f& direction)
@@ -232,9 +252,9 @@ void NetworkSystem::RequestShoot(const sf::Vector2f& position, const sf::Vector2
 	};
 
 	// send shoot request
-	sf::Packet packet;
-	packet << header << shootMessage;
-	SendPacketToServerTcp(packet);
+	m_SendPacket.Clear();
+	m_SendPacket << header << shootMessage;
+	SendPacketToServerTcp(m_SendPacket);
 
 	// spawn the local copy of the projectile
 	// this is to avoid the player feeling like there is lag behind their actions 
@@ -261,9 +281,9 @@ void NetworkSystem::RequestPlaceBlock(const sf::Vector2f& position)
 	};
 	
 	// send message to server
-	sf::Packet packet;
-	packet << header << placeMessage;
-	SendPacketToServerTcp(packet);
+	m_SendPacket.Clear();
+	m_SendPacket << header << placeMessage;
+	SendPacketToServerTcp(m_SendPacket);
 
 	// create a local copy of the block
 	// this is to avoid the player feeling the latency between them and the server
@@ -281,9 +301,9 @@ void NetworkSystem::SyncSimulationTime()
 	// this takes into account the latency
 	// it is measured and subtracted from the time the server tells us
 	MessageHeader header = CreateHeader(MessageCode::GetServerTime);
-	sf::Packet packet;
-	packet << header;
-	SendPacketToServerTcp(packet);
+	m_SendPacket.Clear();
+	m_SendPacket << header;
+	SendPacketToServerTcp(m_SendPacket);
 	m_LatencyPingBegin = m_SimulationTime;
 }
 
@@ -294,17 +314,27 @@ void NetworkSystem::SyncSimulationTime()
 void NetworkSystem::ProcessIncomingUdp()
 {
 	// check for incoming udp data
-	sf::Packet packet;
 	sf::IpAddress fromAddr;
 	unsigned short fromPort;
-	sf::Socket::Status status = m_UdpSocket.receive(packet, fromAddr, fromPort);
+	sf::Socket::Status status = m_UdpSocket.receive(m_ReceivePacket, fromAddr, fromPort);
 	if (status == sf::Socket::Done)
 	{
+		// only the server is allowed to send us updates
+		if (fromAddr != m_ServerAddress || fromPort != m_ServerPort)
+		{
+			LOG_WARN("Received udp data from {}:{}, which isn't the server!", fromAddr.toString(), fromPort);
+			return;
+		}
+
+		PacketReader packet{ m_ReceivePacket };
 		// data was recieved
 		// unpack
 		MessageHeader header;
 		packet >> header;
 
+		TRACE_SCOPE("NetworkSystem::ProcessDatagram", TraceArg{ "code", MessageCodeToStr(header.messageCode) });
+		m_Stats.OnReceived(header.messageCode, m_ReceivePacket.getDataSize());
+
 		// safety checks
 		if (header.clientID != m_ClientID)
 		{
@@ -316,7 +346,7 @@ void NetworkSystem::ProcessIncomingUdp()
 		switch (header.messageCode)
 		{
 		case MessageCode::Update:		OnRecieveUpdate(packet);						break;
-		case MessageCode::Ping:			SendPing();										break;
+		case MessageCode::Ping:			OnPing(packet);									break;
 		default:						LOG_WARN("Received unexpected message code!");	break;
 		}
 	}
@@ -348,110 +378,147 @@ void NetworkSystem::ProcessOutgoingUdp(float dt)
 			playerPos.x, playerPos.y,
 			m_Player->getRotation(),
 			dt,
-			m_SimulationTime
+			m_SimulationTime,
+			m_LatestSnapshot,
+			m_UpdateSequence++
 		};
 
 		// send to server
-		sf::Packet packet;
-		packet << header << messageBody;
-		SendPacketToServerUdp(packet);
+		m_SendPacket.Clear();
+		m_SendPacket << header << messageBody;
+		SendPacketToServerUdp(m_SendPacket);
 	}
 }
 
 void NetworkSystem::ProcessIncomingTcp()
 {
-	// check for any incoming data on the tcp socket
-	sf::Packet packet;
-	auto status = m_TcpSocket.receive(packet);
-	if (status == sf::Socket::Done)
+	// the server sends all of its reliable messages for a tick together,
+	// so receive everything that has arrived rather than one message per frame
+	while (m_ConnectionState == ConnectionState::Connected)
 	{
-		// received data
-		// unpack
-		MessageHeader header;
-		packet >> header;
+		// check for any incoming data on the tcp socket
+		auto status = m_TcpSocket.receive(m_ReceivePacket);
+		if (status == sf::Socket::Done)
+		{
+			// received data
+			// unpack
+			PacketReader packet{ m_ReceivePacket };
+			MessageHeader header;
+			packet >> header;
 
-		// safety checks
-		if (header.clientID != m_ClientID)
+			TRACE_SCOPE("NetworkSystem::ProcessMessage", TraceArg{ "code", MessageCodeToStr(header.messageCode) });
+			m_Stats.OnReceived(header.messageCode, m_ReceivePacket.getDataSize());
+
+			// safety checks
+			if (header.clientID != m_ClientID)
+			{
+				LOG_ERROR("Recieved message addressed to a different client!");
+				continue;
+			}
+
+			// call the appropriate callback depending on the message header
+			switch (header.messageCode)
+			{
+			case MessageCode::Disconnect:			OnDisconnect			();						break;
+			case MessageCode::PlayerConnected:		OnOtherPlayerConnect	(packet);				break;
+			case MessageCode::PlayerDisconnected:	OnOtherPlayerDisconnect	(packet);				break;
+			case MessageCode::ChangeTeam:			OnPlayerChangeTeam		(packet);				break;
+			case MessageCode::GetServerTime:		OnServerTimeUpdate		(packet);				break;
+			case MessageCode::Shoot:				OnShoot					(packet);				break;
+			case MessageCode::ProjectilesDestroyed:	OnProjectilesDestroyed	(packet);				break;
+			case MessageCode::ShootRequestDenied:	OnShootRequestDenied	();						break;
+			case MessageCode::Place:				OnPlace					(packet);				break;
+			case MessageCode::BlocksDestroyed:		OnBlocksDestroyed		(packet);				break;
+			case MessageCode::WorldChunk:			OnWorldChunk			(packet);				break;
+			case MessageCode::PlaceRequestDenied:	OnPlaceRequestDenied	();						break;
+			case MessageCode::ChangeGameState:		OnChangeGameState		(packet);				break;
+			case MessageCode::TurfLineMoved:		OnTurfLineMoved			(packet);				break;
+			case MessageCode::PlayerDeath:			OnPlayerDeath			();						break;
+			case MessageCode::GameStart:			OnGameStart				();						break;
+			default:								LOG_WARN("Recieved unexpected message code");	break;
+			}
+		}
+		else if (status == sf::Socket::Error)
 		{
-			LOG_ERROR("Recieved message addressed to a different client!");
-			return;
+			LOG_ERROR("Error occurred while trying to recieve from server");
+			break;
 		}
-
-		// call the appropriate callback depending on the message header
-		switch (header.messageCode)
+		else if (status == sf::Socket::Disconnected)
 		{
-		case MessageCode::Disconnect:			OnDisconnect			();						break;
-		case MessageCode::PlayerConnected:		OnOtherPlayerConnect	(packet);				break;
-		case MessageCode::PlayerDisconnected:	OnOtherPlayerDisconnect	(packet);				break;
-		case MessageCode::ChangeTeam:			OnPlayerChangeTeam		(packet);				break;
-		case MessageCode::GetServerTime:		OnServerTimeUpdate		(packet);				break;
-		case MessageCode::Shoot:				OnShoot					(packet);				break;
-		case MessageCode::ProjectilesDestroyed:	OnProjectilesDestroyed	(packet);				break;
-		case MessageCode::ShootRequestDenied:	OnShootRequestDenied	();						break;
-		case MessageCode::Place:				OnPlace					(packet);				break;
-		case MessageCode::BlocksDestroyed:		OnBlocksDestroyed		(packet);				break;
-		case MessageCode::PlaceRequestDenied:	OnPlaceRequestDenied	();						break;
-		case MessageCode::ChangeGameState:		OnChangeGameState		(packet);				break;
-		case MessageCode::TurfLineMoved:		OnTurfLineMoved			(packet);				break;
-		case MessageCode::PlayerDeath:			OnPlayerDeath			();						break;
-		case MessageCode::GameStart:			OnGameStart				();						break;
-		default:								LOG_WARN("Recieved unexpected message code");	break;
+			LOG_WARN("Connection unexpectedly disconnected while receiving from server. Cleaning up...");
+			OnDisconnect();
+			break;
+		}
+		else
+		{
+			// nothing left to receive
+			break;
 		}
 	}
-	else if (status == sf::Socket::Error)
+}
+
+
+void NetworkSystem::ProcessOutgoingTcp()
+{
+	// send as much of the queued tcp data as the socket will take
+	// whatever it won't take stays queued until next frame
+	sf::Socket::Status status = m_TcpSendQueue.Flush(m_TcpSocket);
+
+	// check for errors
+	if (status == sf::Socket::Error)
 	{
-		LOG_ERROR("Error occurred while trying to recieve from server");
+		LOG_ERROR("Error sending packet to server!");
 	}
 	else if (status == sf::Socket::Disconnected)
 	{
-		LOG_WARN("Connection unexpectedly disconnected while receiving from server. Cleaning up...");
+		LOG_WARN("Connection unexpectedly disconnected while sending to server. Cleaning up...");
 		OnDisconnect();
 	}
 }
 
-
-void NetworkSystem::SendPacketToServerTcp(sf::Packet& packet)
+void NetworkSystem::SendPacketToServerTcp(PacketWriter& packet)
 {
-	// send a packet to the server via tcp
-	sf::Socket::Status status;
-	do
+	// queue a packet to be sent to the server via tcp
+	// it is framed the same way as an sf::Packet
+	if (!m_TcpSendQueue.Push(packet))
 	{
-		status = m_TcpSocket.send(packet);
-		// repeat until the entire packet has been sent
-	} while (status == sf::Socket::Partial);
-
-	// check for errors
-	if (status != sf::Socket::Done)
-	{
-		if (status == sf::Socket::Error)
-			LOG_ERROR("Error sending packet to server!");
-		else if (status == sf::Socket::Disconnected)
-		{
-			LOG_WARN("Connection unexpectedly disconnected while sending to server. Cleaning up...");
-			OnDisconnect();
-		}
+		// the server hasn't been accepting data for a long time
+		LOG_ERROR("Too much data waiting to be sent to the server. Disconnecting...");
+		OnDisconnect();
+		return;
 	}
+	m_Stats.OnSent(packet);
 }
 
 	
-void NetworkSystem::SendPacketToServerUdp(sf::Packet& packet)
+void NetworkSystem::SendPacketToServerUdp(const PacketWriter& packet)
 {
 	// send a packet to the server via udp
-	sf::Socket::Status status = m_UdpSocket.send(packet, m_ServerAddress, m_ServerPort);
+	sf::Socket::Status status = m_UdpSocket.send(packet.GetData(), packet.GetDataSize(), m_ServerAddress, m_ServerPort);
 	if (status != sf::Socket::Done)
 		LOG_ERROR("Sending message to server failed!");
+	else
+		m_Stats.OnSent(packet);
 }
 
 #pragma endregion
 
 #pragma region Message Callbacks
 
-void NetworkSystem::OnConnect(const MessageHeader& header, sf::Packet& packet)
+void NetworkSystem::OnConnect(const MessageHeader& header, PacketReader& packet)
 {
 	// update connection state
 	m_ConnectionState = ConnectionState::Connected;
 	m_ClientID = header.clientID;
 
+	// statistics start again with every connection
+	m_Stats = ConnectionStats{};
+	m_LastStatsWindow = ConnectionStats{};
+	m_StatsTimer = 0.0f;
+	m_TotalSnapshotsLost = m_TotalLate = m_TotalDuplicates = 0;
+	m_ServerRtt = 0.0f;
+	m_UpdateSequence = 0;
+
 	// unpack message
 	ConnectMessage connectMessage;
 	packet >> connectMessage;
@@ -462,19 +529,14 @@ void NetworkSystem::OnConnect(const MessageHeader& header, sf::Packet& packet)
 	GoToSpawn();
 
 	// construct the other players
-	for (auto i = 0; i < connectMessage.numPlayers; i++)
+	for (const auto& player : connectMessage.players)
 	{
-		NetworkPlayer* newPlayer = new NetworkPlayer(connectMessage.playerIDs[i]);
-		newPlayer->SetTeam(connectMessage.playerTeams[i]);
-		m_NetworkPlayers->push_back(newPlayer);
+		NetworkPlayer* newPlayer = new NetworkPlayer(player.id);
+		newPlayer->SetTeam(player.team);
+		AddNetworkPlayer(newPlayer);
 	}
 
-	// construct all blocks
-	for (auto i = 0; i < connectMessage.numBlocks; i++)
-	{
-		Block* newBlock = new Block(connectMessage.blockIDs[i], connectMessage.blockTeams[i], { connectMessage.blockXs[i] , connectMessage.blockYs[i] });
-		m_Blocks->push_back(newBlock);
-	}
+	// the blocks will arrive in world chunks
 
 	// update game state
 	(*m_GameState) = connectMessage.gameState;
@@ -485,16 +547,16 @@ void NetworkSystem::OnConnect(const MessageHeader& header, sf::Packet& packet)
 	// this will tell the server how to contact it via udp
 	MessageHeader replyHeader = CreateHeader(MessageCode::Introduction);
 	IntroductionMessage replyBody{ static_cast<sf::Uint16>(m_UdpSocket.getLocalPort()) };
-	sf::Packet reply;
-	reply << replyHeader << replyBody;
-	SendPacketToServerTcp(reply);
+	m_SendPacket.Clear();
+	m_SendPacket << replyHeader << replyBody;
+	SendPacketToServerTcp(m_SendPacket);
 
 	// also request the simulation time
 	SyncSimulationTime();
 
 	// debug info
 	LOG_INFO("Connected with ID {}", static_cast<int>(m_ClientID));
-	LOG_INFO("There are {} other players already connected", connectMessage.numPlayers);
+	LOG_INFO("There are {} other players already connected", connectMessage.players.size());
 	LOG_INFO("I am player {}", m_PlayerNumber);
 }
 
@@ -503,6 +565,7 @@ void NetworkSystem::OnDisconnect()
 {
 	// the client has been told to disconnect from the server
 	m_TcpSocket.disconnect();
+	m_TcpSendQueue.Clear();
 	m_ConnectionState = ConnectionState::Disconnected;
 	m_ClientID = INVALID_CLIENT_ID;
 
@@ -513,10 +576,16 @@ void NetworkSystem::OnDisconnect()
 	(*m_GameState) = GameState::Lobby;
 	m_RemainingGameStateDuration = 0;
 
+	// forget any snapshots, the next server will start from scratch
+	for (auto& snapshot : m_Snapshots)
+		snapshot.sequence = NO_SNAPSHOT;
+	m_LatestSnapshot = NO_SNAPSHOT;
+
 	// delete game objects
 	for (auto player : *m_NetworkPlayers)
 		delete player;
 	m_NetworkPlayers->clear();
+	std::fill(std::begin(m_NetworkPlayersByID), std::end(m_NetworkPlayersByID), nullptr);
 	for (auto projectile : *m_Projectiles)
 		delete projectile;
 	m_Projectiles->clear();
@@ -527,7 +596,7 @@ void NetworkSystem::OnDisconnect()
 	LOG_INFO("Disconnected");
 }
 
-void NetworkSystem::OnOtherPlayerConnect(sf::Packet& packet)
+void NetworkSystem::OnOtherPlayerConnect(PacketReader& packet)
 {
 	// another player has joined the game
 	
@@ -540,10 +609,10 @@ void NetworkSystem::OnOtherPlayerConnect(sf::Packet& packet)
 	// construct the new player
 	NetworkPlayer* newPlayer = new NetworkPlayer(messageBody.playerID);
 	newPlayer->SetTeam(messageBody.team);
-	m_NetworkPlayers->push_back(newPlayer);
+	AddNetworkPlayer(newPlayer);
 }
 
-void NetworkSystem::OnOtherPlayerDisconnect(sf::Packet& packet)
+void NetworkSystem::OnOtherPlayerDisconnect(PacketReader& packet)
 {
 	// a player has left the game
 
@@ -554,44 +623,97 @@ void NetworkSystem::OnOtherPlayerDisconnect(sf::Packet& packet)
 	LOG_INFO("Player ID {} has left", messageBody.playerID);
 
 	// find the player to delete
-	auto it = m_NetworkPlayers->begin();
-	for (; it != m_NetworkPlayers->end(); it++)
+	NetworkPlayer* player = FindNetworkPlayerWithID(messageBody.playerID);
+	if (!player)
 	{
-		if ((*it)->GetID() == messageBody.playerID) break;
-	}
-	// make sure we found them
-	if (it != m_NetworkPlayers->end())
-	{
-		// delete the player
-		delete (*it);
-		m_NetworkPlayers->erase(it);
-	}
-	else
 		LOG_WARN("Player {} doesn't exist!", messageBody.playerID);
+		return;
+	}
+
+	// delete the player
+	m_NetworkPlayersByID[messageBody.playerID] = nullptr;
+	m_NetworkPlayers->erase(std::find(m_NetworkPlayers->begin(), m_NetworkPlayers->end(), player));
+	delete player;
 }
 
-void NetworkSystem::OnRecieveUpdate(sf::Packet& packet)
+void NetworkSystem::OnRecieveUpdate(PacketReader& packet)
 {
-	// the client has recieved an update telling it about all the other players in the game
+	// the client has recieved a snapshot telling it about all the other players in the game
+	// it only contains the players that have changed since a snapshot we've already received
+
+	SnapshotHeader header;
+	packet >> header;
 
-	UpdateMessage messageBody;
+	if (header.sequence == NO_SNAPSHOT) return;
+	m_Stats.OnSequenceReceived(header.sequence);
 
-	// packet will potentially contain updates for multiple players
-	// loop while the packet still contains data
-	while (!packet.endOfPacket())
+	// a second copy of the latest snapshot says nothing new about the network
+	if (header.sequence == m_LatestSnapshot) return;
+	m_Stats.OnTransit(header.sendTime, m_StatsClock.getElapsedTime().asSeconds());
+
+	// snapshots older than the latest one are of no use anymore
+	if (m_LatestSnapshot != NO_SNAPSHOT && !SequenceMoreRecent(header.sequence, m_LatestSnapshot))
 	{
-		packet >> messageBody;
+		m_Stats.OnLate();
+		return;
+	}
 
-		// we don't need to be updated about ourselves
-		if (messageBody.playerID == m_ClientID) continue;
+	// the time between snapshots is used as the dt of the player updates
+	float dt = UPDATE_FREQUENCY;
+	if (m_LatestSnapshot != NO_SNAPSHOT)
+		dt = header.serverTime - m_Snapshots[m_LatestSnapshot % SNAPSHOT_BUFFER_SIZE].serverTime;
 
-		// update the player
-		NetworkPlayer* player = FindNetworkPlayerWithID(messageBody.playerID);
-		if (player) player->NetworkUpdate(messageBody, m_SimulationTime);
+	// start from the baseline the server encoded against
+	Snapshot& snapshot = m_Snapshots[header.sequence % SNAPSHOT_BUFFER_SIZE];
+	if (header.baseline == NO_SNAPSHOT)
+	{
+		snapshot.Clear(header.sequence, header.serverTime);
+	}
+	else
+	{
+		const Snapshot& baseline = m_Snapshots[header.baseline % SNAPSHOT_BUFFER_SIZE];
+		if (baseline.sequence != header.baseline || &baseline == &snapshot)
+		{
+			LOG_WARN("Received snapshot {} relative to snapshot {}, which we no longer have", header.sequence, header.baseline);
+			return;
+		}
+		snapshot = baseline;
+		snapshot.sequence = header.sequence;
+		snapshot.serverTime = header.serverTime;
+	}
+
+	// apply the changes
+	if (!ReadSnapshotDelta(packet, snapshot))
+	{
+		LOG_WARN("Received malformed snapshot!");
+		snapshot.sequence = NO_SNAPSHOT;
+		return;
+	}
+	m_LatestSnapshot = header.sequence;
+
+	// update every player from the reconstructed snapshot, whether they moved or not
+	for (auto player : *m_NetworkPlayers)
+	{
+		const PlayerSnapshot& state = snapshot.players[player->GetID()];
+		if (!state.present) continue;
+
+		sf::Vector2f position = state.GetPosition();
+		// the update is only used locally, so it doesn't acknowledge any snapshot or need a sequence number
+		UpdateMessage update
+		{
+			player->GetID(),
+			position.x, position.y,
+			state.GetRotation(),
+			dt,
+			header.serverTime,
+			NO_SNAPSHOT,
+			0
+		};
+		player->NetworkUpdate(update, m_SimulationTime);
 	}
 }
 
-void NetworkSystem::OnPlayerChangeTeam(sf::Packet& packet)
+void NetworkSystem::OnPlayerChangeTeam(PacketReader& packet)
 {
 	// a player has changed team
 
@@ -607,14 +729,15 @@ void NetworkSystem::OnPlayerChangeTeam(sf::Packet& packet)
 	else
 	{
 		NetworkPlayer* player = FindNetworkPlayerWithID(messageBody.playerID);
-		player->SetTeam(messageBody.team);
+		if (player) player->SetTeam(messageBody.team);
 	}
 }
 
-void NetworkSystem::OnServerTimeUpdate(sf::Packet& packet)
+void NetworkSystem::OnServerTimeUpdate(PacketReader& packet)
 {
 	// measure round trip time
 	float latency = m_SimulationTime - m_LatencyPingBegin;
+	m_Stats.AddRttSample(latency);
 
 	// get the servers simulation time
 	ServerTimeMessage messageBody;
@@ -623,7 +746,7 @@ void NetworkSystem::OnServerTimeUpdate(sf::Packet& packet)
 	m_SimulationTime = messageBody.serverTime - (0.5f * latency);
 }
 
-void NetworkSystem::OnShoot(sf::Packet& packet)
+void NetworkSystem::OnShoot(PacketReader& packet)
 {
 	// extract message body
 	ShootMessage shootMessage;
@@ -646,31 +769,19 @@ void NetworkSystem::OnShoot(sf::Packet& packet)
 	}
 }
 
-void NetworkSystem::OnProjectilesDestroyed(sf::Packet& packet)
+void NetworkSystem::OnProjectilesDestroyed(PacketReader& packet)
 {
 	// one or more projectiles have been destroyed
 
 	// unpack message
 	ProjectilesDestroyedMessage message;
-	packet >> message;
+	if (!(packet >> message)) return;
 
-	// find out which projectile has been destroyed
-	for (auto it = m_Projectiles->begin(); it != m_Projectiles->end();)
-	{
-		bool projDestroyed = false;
-		for (auto i = 0; i < message.count; i++)
-		{
-			if ((*it)->GetID() == message.ids[i])
-			{
-				// delete projectile
-				it = m_Projectiles->erase(it);
-				projDestroyed = true;
-				break;
-			}
-		}
-		if (!projDestroyed)
-			it++;
-	}
+	// find out which projectiles have been destroyed
+	// there can be thousands of ids in one message, so sort them to look each projectile up with a binary search
+	std::sort(message.ids.begin(), message.ids.end());
+	auto destroyed = [&message](const Projectile* projectile) { return std::binary_search(message.ids.begin(), message.ids.end(), projectile->GetID()); };
+	m_Projectiles->erase(std::remove_if(m_Projectiles->begin(), m_Projectiles->end(), destroyed), m_Projectiles->end());
 }
 
 void NetworkSystem::OnShootRequestDenied()
@@ -696,7 +807,7 @@ void NetworkSystem::OnShootRequestDenied()
 	(*m_Ammo)++;
 }
 
-void NetworkSystem::OnPlace(sf::Packet& packet)
+void NetworkSystem::OnPlace(PacketReader& packet)
 {
 	// a block has been placed
 
@@ -720,29 +831,35 @@ void NetworkSystem::OnPlace(sf::Packet& packet)
 	}
 }
 
-void NetworkSystem::OnBlocksDestroyed(sf::Packet& packet)
+void NetworkSystem::OnBlocksDestroyed(PacketReader& packet)
 {
 	// one or more block were destroyed
 
 	BlocksDestroyedMessage message;
-	packet >> message;
+	if (!(packet >> message)) return;
 
 	// find which blocks were destroyed and destroy them
-	for (auto it = m_Blocks->begin(); it != m_Blocks->end();)
+	std::sort(message.ids.begin(), message.ids.end());
+	auto destroyed = [&message](const Block* block) { return std::binary_search(message.ids.begin(), message.ids.end(), block->GetID()); };
+	m_Blocks->erase(std::remove_if(m_Blocks->begin(), m_Blocks->end(), destroyed), m_Blocks->end());
+}
+
+void NetworkSystem::OnWorldChunk(PacketReader& packet)
+{
+	// part of the world we joined
+	// the blocks are added as soon as they arrive, so the world fills in while the rest is still on its way
+
+	WorldChunkMessage message;
+	if (!(packet >> message)) return;
+
+	for (const auto& block : message.blocks)
 	{
-		bool blockDestroyed = false;
-		for (auto i = 0; i < message.count; i++)
-		{
-			if ((*it)->GetID() == message.ids[i])
-			{
-				it = m_Blocks->erase(it);
-				blockDestroyed = true;
-				break;
-			}
-		}
-		if (!blockDestroyed)
-			it++;
+		Block* newBlock = new Block(block.id, block.team, BlockCellPosition(block.cell));
+		m_Blocks->push_back(newBlock);
 	}
+
+	if (message.last)
+		LOG_INFO("Received the world: {} blocks", m_Blocks->size());
 }
 
 void NetworkSystem::OnPlaceRequestDenied()
@@ -766,7 +883,7 @@ void NetworkSystem::OnPlaceRequestDenied()
 	(*m_BuildModeBlocks)++;
 }
 
-void NetworkSystem::OnChangeGameState(sf::Packet& packet)
+void NetworkSystem::OnChangeGameState(PacketReader& packet)
 {
 	// the game state has changed
 
@@ -805,7 +922,7 @@ void NetworkSystem::OnChangeGameState(sf::Packet& packet)
 	}
 }
 
-void NetworkSystem::OnTurfLineMoved(sf::Packet& packet)
+void NetworkSystem::OnTurfLineMoved(PacketReader& packet)
 {
 	// move turf line
 	TurfLineMoveMessage message;
@@ -834,14 +951,20 @@ void NetworkSystem::OnGameStart()
 	m_GameStartRequested = false;
 }
 
-void NetworkSystem::SendPing()
+void NetworkSystem::OnPing(PacketReader& packet)
 {
-	// the server pings the clients to measure latency
-	// we don't need to give it any data, just telling the server were awake is plenty
+	PingMessage pingMessage;
+	packet >> pingMessage;
+	if (!packet) return;
+
+	// the server's estimate is filtered over many pings, so it is steadier than what the time syncs measure
+	m_ServerRtt = pingMessage.rtt;
+
+	// send it straight back, so the server measures the network rather than the frame rate
 	MessageHeader header{ m_ClientID, MessageCode::Ping };
-	sf::Packet p;
-	p << header;
-	SendPacketToServerUdp(p);
+	m_SendPacket.Clear();
+	m_SendPacket << header << pingMessage;
+	SendPacketToServerUdp(m_SendPacket);
 }
 
 
@@ -850,13 +973,10 @@ void NetworkSystem::SendPing()
 #pragma region Utility
 
 
-NetworkPlayer* NetworkSystem::FindNetworkPlayerWithID(ClientID id)
+void NetworkSystem::AddNetworkPlayer(NetworkPlayer* player)
 {
-	for (auto player : *m_NetworkPlayers)
-	{
-		if (player->GetID() == id) return player;
-	}
-	return nullptr;
+	m_NetworkPlayers->push_back(player);
+	m_NetworkPlayersByID[player->GetID()] = player;
 }
 
 void NetworkSystem::GoToSpawn()
@@ -867,4 +987,66 @@ void NetworkSystem::GoToSpawn()
 		m_Player->setPosition({ WORLD_WIDTH - 0.5f * SPAWN_WIDTH, 0.5f * WORLD_HEIGHT });
 }
 
+void NetworkSystem::SampleStats()
+{
+	// write over the oldest sample
+	int i = m_StatsHistoryOffset;
+	m_BytesInHistory[i] = m_Stats.GetTotalReceived().bytes / (1024.0f * CLIENT_STATS_SAMPLE_INTERVAL);
+	m_BytesOutHistory[i] = m_Stats.GetTotalSent().bytes / (1024.0f * CLIENT_STATS_SAMPLE_INTERVAL);
+	m_RttHistory[i] = 1000.0f * m_ServerRtt;
+	m_JitterHistory[i] = 1000.0f * m_Stats.GetJitter();
+	m_LossHistory[i] = 100.0f * m_Stats.GetLossRate();
+	m_StatsHistoryOffset = (m_StatsHistoryOffset + 1) % STATS_HISTORY_SIZE;
+
+	m_TotalSnapshotsLost += m_Stats.GetSequencedLost();
+	m_TotalLate += m_Stats.GetLate();
+	m_TotalDuplicates += m_Stats.GetDuplicates();
+
+	m_LastStatsWindow = m_Stats;
+	m_Stats.ResetCounters();
+}
+
+void NetworkSystem::StatsGUI()
+{
+	if (!ImGui::CollapsingHeader("Network Statistics")) return;
+
+	ImGui::Text("RTT: %.1fms (measured by the server)", 1000.0f * m_ServerRtt);
+	ImGui::Text("Time sync RTT: %.1fms (smoothed %.1fms, var %.1fms)", 1000.0f * m_Stats.GetLastRtt(), 1000.0f * m_Stats.GetSmoothedRtt(), 1000.0f * m_Stats.GetRttVariance());
+	ImGui::Text("Snapshot jitter: %.1fms", 1000.0f * m_Stats.GetJitter());
+	ImGui::Text("Snapshots lost: %u, late: %u, duplicated: %u", m_TotalSnapshotsLost, m_TotalLate, m_TotalDuplicates);
+
+	// the graphs are oldest on the left, newest on the right
+	ImVec2 graphSize{ 0.0f, 40.0f };
+	char overlay[32];
+	int newest = (m_StatsHistoryOffset + STATS_HISTORY_SIZE - 1) % STATS_HISTORY_SIZE;
+
+	snprintf(overlay, sizeof(overlay), "%.2f KB/s", m_BytesInHistory[newest]);
+	ImGui::PlotLines("In", m_BytesInHistory, STATS_HISTORY_SIZE, m_StatsHistoryOffset, overlay, 0.0f, FLT_MAX, graphSize);
+	snprintf(overlay, sizeof(overlay), "%.2f KB/s", m_BytesOutHistory[newest]);
+	ImGui::PlotLines("Out", m_BytesOutHistory, STATS_HISTORY_SIZE, m_StatsHistoryOffset, overlay, 0.0f, FLT_MAX, graphSize);
+	snprintf(overlay, sizeof(overlay), "%.1f ms", m_RttHistory[newest]);
+	ImGui::PlotLines("RTT", m_RttHistory, STATS_HISTORY_SIZE, m_StatsHistoryOffset, overlay, 0.0f, FLT_MAX, graphSize);
+	snprintf(overlay, sizeof(overlay), "%.1f ms", m_JitterHistory[newest]);
+	ImGui::PlotLines("Jitter", m_JitterHistory, STATS_HISTORY_SIZE, m_StatsHistoryOffset, overlay, 0.0f, FLT_MAX, graphSize);
+	snprintf(overlay, sizeof(overlay), "%.1f %%", m_LossHistory[newest]);
+	ImGui::PlotLines("Loss", m_LossHistory, STATS_HISTORY_SIZE, m_StatsHistoryOffset, overlay, 0.0f, 100.0f, graphSize);
+
+	if (ImGui::TreeNode("Messages"))
+	{
+		// per second, over the last sample
+		float scale = 1.0f / CLIENT_STATS_SAMPLE_INTERVAL;
+		for (size_t i = 0; i < NUM_MESSAGE_CODES; i++)
+		{
+			MessageCode code = static_cast<MessageCode>(i);
+			const MessageTraffic& in = m_LastStatsWindow.GetReceived(code);
+			const MessageTraffic& out = m_LastStatsWindow.GetSent(code);
+			if (in.packets == 0 && out.packets == 0) continue;
+
+			ImGui::Text("%s: in %.0f/s (%.0f B/s), out %.0f/s (%.0f B/s)", MessageCodeToStr(code),
+				scale * in.packets, scale * in.bytes, scale * out.packets, scale * out.bytes);
+		}
+		ImGui::TreePop();
+	}
+}
+
 #pragma endregion
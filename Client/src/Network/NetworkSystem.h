@@ -2,6 +2,10 @@
 
 #include <SFML/Network.hpp>
 #include "Network/NetworkTypes.h"
+#include "Network/Snapshot.h"
+#include "Network/WorldChunk.h"
+#include "Network/TcpSendQueue.h"
+#include "Network/ConnectionStats.h"
 #include "Log.h"
 
 #include <vector>
@@ -63,37 +67,45 @@ private:
 	void ProcessIncomingUdp();
 	void ProcessOutgoingUdp(float dt);
 	void ProcessIncomingTcp();
+	void ProcessOutgoingTcp();
 
 	// send to server
-	void SendPacketToServerTcp(sf::Packet& packet);
-	void SendPacketToServerUdp(sf::Packet& packet);
+	void SendPacketToServerTcp(PacketWriter& packet);
+	void SendPacketToServerUdp(const PacketWriter& packet);
 
 	// callbacks from messages
-	void OnConnect					(const MessageHeader&, sf::Packet&);
+	void OnConnect					(const MessageHeader&, PacketReader&);
 	void OnDisconnect				();
-	void OnOtherPlayerConnect		(sf::Packet&);
-	void OnOtherPlayerDisconnect	(sf::Packet&);
-	void OnRecieveUpdate			(sf::Packet&);
-	void OnPlayerChangeTeam			(sf::Packet&);
-	void OnServerTimeUpdate			(sf::Packet&);
-	void OnShoot					(sf::Packet&);
-	void OnProjectilesDestroyed		(sf::Packet&);
+	void OnOtherPlayerConnect		(PacketReader&);
+	void OnOtherPlayerDisconnect	(PacketReader&);
+	void OnRecieveUpdate			(PacketReader&);
+	void OnPlayerChangeTeam			(PacketReader&);
+	void OnServerTimeUpdate			(PacketReader&);
+	void OnShoot					(PacketReader&);
+	void OnProjectilesDestroyed		(PacketReader&);
 	void OnShootRequestDenied		();
-	void OnPlace					(sf::Packet&);
-	void OnBlocksDestroyed			(sf::Packet&);
+	void OnPlace					(PacketReader&);
+	void OnBlocksDestroyed			(PacketReader&);
+	void OnWorldChunk				(PacketReader&);
 	void OnPlaceRequestDenied		();
-	void OnChangeGameState			(sf::Packet&);
-	void OnTurfLineMoved			(sf::Packet&);
+	void OnChangeGameState			(PacketReader&);
+	void OnTurfLineMoved			(PacketReader&);
 	void OnPlayerDeath				();
 	void OnGameStart				();
 
-	// for measuring latency - the server measures the latency to all clients every second
-	void SendPing();
+	// for measuring latency - the server pings every client several times a second, and they answer straight away
+	void OnPing(PacketReader& packet);
+
+	// add the statistics of the last window to the graphs, and start a new window
+	void SampleStats();
+	void StatsGUI();
 
 	// create a header for a message to send to the server
 	inline MessageHeader CreateHeader(MessageCode messageCode) const { return MessageHeader{ m_ClientID, messageCode }; }
 
-	NetworkPlayer* FindNetworkPlayerWithID(ClientID id);
+	// constant time, every possible id has a slot in m_NetworkPlayersByID
+	inline NetworkPlayer* FindNetworkPlayerWithID(ClientID id) const { return m_NetworkPlayersByID[id]; }
+	void AddNetworkPlayer(NetworkPlayer* player);
 
 	void GoToSpawn();
 
@@ -107,6 +119,12 @@ private:
 	sf::TcpSocket m_TcpSocket;
 	sf::UdpSocket m_UdpSocket;
 
+	// reused for every message so that sending and receiving doesn't allocate
+	PacketWriter m_SendPacket;
+	sf::Packet m_ReceivePacket;
+	// tcp messages waiting for the socket to accept them
+	TcpSendQueue m_TcpSendQueue{ TCP_SEND_QUEUE_SOFT_LIMIT, TCP_SEND_QUEUE_HARD_LIMIT };
+
 	// connection status
 	ConnectionState m_ConnectionState = ConnectionState::Disconnected;
 	ClientID m_ClientID = INVALID_CLIENT_ID;
@@ -120,15 +138,44 @@ private:
 
 	float m_UpdateTimer = 0.0f;
 	float m_LastUpdateTime = 0.0f;
+	sf::Uint16 m_UpdateSequence = 0;
 
 	float m_RemainingGameStateDuration = 0.0f;
 
+	// the most recent snapshots received from the server, reconstructed in full
+	// the server delta-encodes against whichever one of these we last acknowledged
+	Snapshot m_Snapshots[SNAPSHOT_BUFFER_SIZE];
+	SnapshotSequence m_LatestSnapshot = NO_SNAPSHOT;
+
 	// the game will start once all players request to begin
 	bool m_GameStartRequested = false;
 
+	// traffic and connection quality
+	// the server's snapshots are sequenced, so they are used to measure loss and jitter
+	ConnectionStats m_Stats;
+	// the last complete window, for showing per message code
+	ConnectionStats m_LastStatsWindow;
+	sf::Clock m_StatsClock; // real time, for timing arrivals
+	float m_StatsTimer = 0.0f;
+	// snapshots older than the latest are thrown away, so they all count as late rather than out of order
+	unsigned int m_TotalSnapshotsLost = 0, m_TotalLate = 0, m_TotalDuplicates = 0;
+	// the round trip time the server has measured, sent along with its pings
+	float m_ServerRtt = 0.0f;
+
+	// graphs of the last STATS_HISTORY_SIZE samples, as ring buffers starting at m_StatsHistoryOffset
+	static const int STATS_HISTORY_SIZE = 120;
+	int m_StatsHistoryOffset = 0;
+	float m_BytesInHistory[STATS_HISTORY_SIZE] = {};
+	float m_BytesOutHistory[STATS_HISTORY_SIZE] = {};
+	float m_RttHistory[STATS_HISTORY_SIZE] = {};
+	float m_JitterHistory[STATS_HISTORY_SIZE] = {};
+	float m_LossHistory[STATS_HISTORY_SIZE] = {};
+
 	// pointers to game objects and game object containers
 	ControllablePlayer* m_Player = nullptr;
 	std::vector<NetworkPlayer*>* m_NetworkPlayers = nullptr;
+	// the same players indexed by id, nullptr where there is no player with that id
+	NetworkPlayer* m_NetworkPlayersByID[INVALID_CLIENT_ID + 1] = {};
 
 	std::vector<Projectile*>* m_Projectiles = nullptr;
 	// projectile requests are sent using tcp so we know request responses
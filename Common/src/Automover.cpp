@@ -0,0 +1,39 @@
+#include "Automover.h"
+
+#include "Constants.h"
+
+
+Automover::Automover(float startTime)
+{
+	// skip to the point in the pattern the start time falls at
+	m_Time = startTime;
+	while (m_Time > m_TimerX)
+	{
+		m_TimerX += 2.31f;
+		m_DirectionX = -m_DirectionX;
+	}
+	while (m_Time > m_TimerY)
+	{
+		m_TimerY += 3.58f;
+		m_DirectionY = -m_DirectionY;
+	}
+}
+
+sf::Vector2f Automover::Step(float dt)
+{
+	sf::Vector2f velocity{ dt * m_DirectionX * PLAYER_MOVE_SPEED, dt * m_DirectionY * PLAYER_MOVE_SPEED };
+
+	m_Time += dt;
+	if (m_Time > m_TimerX)
+	{
+		m_TimerX += 2.31f;
+		m_DirectionX = -m_DirectionX;
+	}
+	if (m_Time > m_TimerY)
+	{
+		m_TimerY += 3.58f;
+		m_DirectionY = -m_DirectionY;
+	}
+
+	return velocity;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+
+// moves a player in a semi random direction and switches direction every so often
+// used to move players without any input for testing, by the client's automove option and by bots
+class Automover
+{
+public:
+	// starting from a later time changes the pattern, so that many players moving at once aren't all in step
+	explicit Automover(float startTime = 0.0f);
+
+	// how far to move this frame
+	sf::Vector2f Step(float dt);
+
+private:
+	float m_Time = 0.0f;
+	float m_DirectionX = 0.0f;
+	float m_DirectionY = 1.0f;
+	float m_TimerX = 2.0f;
+	float m_TimerY = 10.0f;
+};
@@ -1,31 +1,29 @@
 #include "CommonTypes.h"
 
 
-sf::Packet& operator <<(sf::Packet& packet, const PlayerTeam& team)
+PacketWriter& operator <<(PacketWriter& packet, const PlayerTeam& team)
 {
 	return packet << static_cast<sf::Uint8>(team);
 }
 
-sf::Packet& operator >>(sf::Packet& packet, PlayerTeam& team)
+PacketReader& operator >>(PacketReader& packet, PlayerTeam& team)
 {
 	sf::Uint8 team_int;
-	packet >> team_int;
-
-	team = static_cast<PlayerTeam>(team_int);
+	if (packet >> team_int)
+		team = static_cast<PlayerTeam>(team_int);
 	return packet;
 }
 
-sf::Packet& operator <<(sf::Packet& packet, const GameState& state)
+PacketWriter& operator <<(PacketWriter& packet, const GameState& state)
 {
 	return packet << static_cast<sf::Uint8>(state);
 }
 
-sf::Packet& operator >>(sf::Packet& packet, GameState& state)
+PacketReader& operator >>(PacketReader& packet, GameState& state)
 {
 	sf::Uint8 state_int;
-	packet >> state_int;
-
-	state = static_cast<GameState>(state_int);
+	if (packet >> state_int)
+		state = static_cast<GameState>(state_int);
 	return packet;
 }
 
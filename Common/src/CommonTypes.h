@@ -1,6 +1,8 @@
 #pragma once
 
 #include <SFML/Network.hpp>
+#include "Network/PacketWriter.h"
+#include "Network/PacketReader.h"
 
 /*
 Common types shared between the client and server projects
@@ -13,8 +15,8 @@ enum class PlayerTeam : sf::Uint8
 	Red,
 	Blue
 };
-sf::Packet& operator <<(sf::Packet& packet, const PlayerTeam& team);
-sf::Packet& operator >>(sf::Packet& packet, PlayerTeam& team);
+PacketWriter& operator <<(PacketWriter& packet, const PlayerTeam& team);
+PacketReader& operator >>(PacketReader& packet, PlayerTeam& team);
 
 
 enum class GameState : sf::Uint8
@@ -23,8 +25,8 @@ enum class GameState : sf::Uint8
 	FightMode,
 	BuildMode,
 };
-sf::Packet& operator <<(sf::Packet& packet, const GameState& state);
-sf::Packet& operator >>(sf::Packet& packet, GameState& state);
+PacketWriter& operator <<(PacketWriter& packet, const GameState& state);
+PacketReader& operator >>(PacketReader& packet, GameState& state);
 
 const char* GameStateToStr(GameState s);
 
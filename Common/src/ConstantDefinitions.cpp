@@ -6,9 +6,27 @@ const unsigned short SERVER_PORT = 4444;
 
 const float IDLE_TIMEOUT = 5.0f; // 5 second timout
 const float UPDATE_FREQUENCY = 1.0f / 20.0f; // update ticks 20 times a second
-const float PING_FREQUENCY = 1.0f; // the server will measure a clients latency once every second
+const float PING_FREQUENCY = 0.25f; // the server will measure a clients latency four times a second
 const float MAX_MOVE_DISTANCE = 100.0f; // if a player moved more than 100 units in a single update then consider it to have been forcibly teleported
 const float STATE_HISTORY_DURATION = 3.0f; // store the last 3 seconds of a players state
+const float MAX_LAG_COMPENSATION = 0.5f; // players with more latency than this have to lead their shots
+const unsigned int MAX_UDP_DATAGRAMS_PER_TICK = 1024; // enough to absorb a long stall with every player in every room sending updates
+const float SERVER_STATS_FREQUENCY = 10.0f; // log network statistics every 10 seconds
+const char* const SERVER_STATS_FILE = "server_stats.json"; // relative to the server's working directory
+const char* const SERVER_TRACE_FILE = "server_trace.json";
+const char* const CLIENT_TRACE_FILE = "client_trace.json";
+const float CLIENT_STATS_SAMPLE_INTERVAL = 0.25f;
+const float MIN_SELECTOR_TIMEOUT = 0.0001f;
+const float SIMULATION_TICK_RATE = 30.0f; // simulate 30 times a second (collisions are swept, so this does not need to be high)
+const float SIMULATION_TIMESTEP = 1.0f / SIMULATION_TICK_RATE;
+const unsigned int MAX_SIMULATION_STEPS_PER_FRAME = 5;
+const unsigned int TCP_SEND_QUEUE_SOFT_LIMIT = 64 * 1024;
+const unsigned int TCP_SEND_QUEUE_HARD_LIMIT = 512 * 1024; // several seconds of fight mode traffic, the client isn't coming back from that
+const float TCP_SEND_RETRY_INTERVAL = 0.005f;
+const unsigned int WORLD_CHUNK_MAX_BLOCKS = 128; // a few hundred bytes per chunk
+const unsigned int MAX_NUM_ROOMS = 16; // 16 full rooms use up every client id
+const unsigned int SERVER_WORKER_THREADS = 0;
+const unsigned int NETWORK_QUEUE_SIZE = 4096; // a few ticks of datagrams from every player
 
 // world bounds
 const float WORLD_WIDTH = 900.0f;
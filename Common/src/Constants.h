@@ -14,7 +14,8 @@ extern const unsigned short SERVER_PORT;
 extern const float IDLE_TIMEOUT;
 // how often messages are sent client->server and server->client
 extern const float UPDATE_FREQUENCY;
-// how often the server measures client latencey
+// how often the server pings each client to measure their latency
+// every client is on its own schedule, so the pings are spread across ticks rather than all going out at once
 extern const float PING_FREQUENCY;
 // if a player travels a distance greater than this in a single UPDATE_FREQUENCY,
 // then they are considered to have been forcibly teleported
@@ -22,11 +23,56 @@ extern const float PING_FREQUENCY;
 extern const float MAX_MOVE_DISTANCE;
 // the length of time (in seconds) of state history to retain for players, both on server and clients
 extern const float STATE_HISTORY_DURATION;
+// the furthest back in time the server will rewind players when checking if a projectile hit them
+extern const float MAX_LAG_COMPENSATION;
+// the max number of udp datagrams the server will drain from its socket in a single tick
+extern const unsigned int MAX_UDP_DATAGRAMS_PER_TICK;
+// how often the server logs a summary of its network statistics
+extern const float SERVER_STATS_FREQUENCY;
+// every report the server also writes its tick timings here as json, empty to not write the file
+extern const char* const SERVER_STATS_FILE;
+// where the server and client write their traces when built with ENABLE_TRACING
+extern const char* const SERVER_TRACE_FILE;
+extern const char* const CLIENT_TRACE_FILE;
+// how often the client samples its connection statistics for the graphs in its gui
+extern const float CLIENT_STATS_SAMPLE_INTERVAL;
+// the server sleeps until a socket is readable or its next timer is due
+// a zero timeout would make it wait forever, so this is the shortest time it will sleep for
+extern const float MIN_SELECTOR_TIMEOUT;
+// the server simulates the game in fixed steps, independently of how often it sends updates
+extern const float SIMULATION_TICK_RATE;
+extern const float SIMULATION_TIMESTEP;
+// if the server falls further behind than this many steps, the extra time is dropped
+extern const unsigned int MAX_SIMULATION_STEPS_PER_FRAME;
+// reliable messages that a socket won't take straight away are queued (in bytes)
+// a connection with more than the soft limit queued is backlogged, one that would go over the hard limit is dropped
+extern const unsigned int TCP_SEND_QUEUE_SOFT_LIMIT;
+extern const unsigned int TCP_SEND_QUEUE_HARD_LIMIT;
+// while data is queued the server wakes up this often to try sending it again
+extern const float TCP_SEND_RETRY_INTERVAL;
+// joining clients are sent the blocks in the world a chunk at a time, one chunk per client per tick
+extern const unsigned int WORLD_CHUNK_MAX_BLOCKS;
+// the server hosts many matches at once, each in its own room
+// rooms are opened as players join, up to this many
+extern const unsigned int MAX_NUM_ROOMS;
+// rooms are updated in parallel on this many threads on top of the main thread
+// 0 uses one less than the number of hardware threads
+extern const unsigned int SERVER_WORKER_THREADS;
+// datagrams are passed between the network thread and the rest of the server through queues of this many
+extern const unsigned int NETWORK_QUEUE_SIZE;
 
 // max game objects (these are used as stack-allocated array dimensions, so cannot be marked as extern and compiled in a different compilation unit)
+// these are per room
+// player ids are 8 bits and unique across the whole server, so there can never be more players in all the rooms together than MAX_CLIENT_ID
 const sf::Uint8 MAX_NUM_PLAYERS = 16;
-const sf::Uint8 MAX_NUM_BLOCKS = 255;
-const sf::Uint8 MAX_NUM_PROJECTILES = 255;
+const sf::Uint16 MAX_NUM_BLOCKS = 4096;
+const sf::Uint16 MAX_NUM_PROJECTILES = 4096;
+
+// latency measurement (also used as array dimensions)
+// a ping that hasn't been answered by the time this many newer ones have been sent is counted as lost
+const unsigned int MAX_PINGS_IN_FLIGHT = 8;
+// latency is smoothed from the lowest of this many recent round trips, so a single delayed reply doesn't throw it off
+const unsigned int RTT_MIN_FILTER_SAMPLES = 4;
 
 // world bounds
 extern const float WORLD_WIDTH;
@@ -10,7 +10,7 @@ float SqrLength(const sf::Vector2f& v)
 
 float Length(const sf::Vector2f& v)
 {
-	return std::sqrtf(SqrLength(v));
+	return std::sqrt(SqrLength(v));
 }
 
 void Normalize(sf::Vector2f& v)
@@ -111,3 +111,87 @@ float Smoothstep(float edge0, float edge1, float x)
 
 	return x * x * (3.0f - 2.0f * x);
 }
+
+bool SweptCircleCircle(const sf::Vector2f& start, const sf::Vector2f& end, float radius, const sf::Vector2f& centre, float otherRadius, float& t)
+{
+	// equivalent to testing the line segment against a circle with the combined radius
+	float r = radius + otherRadius;
+	sf::Vector2f d = end - start;
+	sf::Vector2f f = start - centre;
+
+	// already touching at the start of the movement
+	float c = SqrLength(f) - r * r;
+	if (c <= 0.0f)
+	{
+		t = 0.0f;
+		return true;
+	}
+
+	// solve |f + t * d|^2 = r^2 for the smallest t
+	float a = SqrLength(d);
+	if (a <= 0.0f) return false;
+
+	float b = 2.0f * (f.x * d.x + f.y * d.y);
+	float discriminant = b * b - 4.0f * a * c;
+	if (discriminant < 0.0f) return false;
+
+	float hit = (-b - std::sqrt(discriminant)) / (2.0f * a);
+	if (hit < 0.0f || hit > 1.0f) return false;
+
+	t = hit;
+	return true;
+}
+
+bool SweptCircleAABB(const sf::Vector2f& start, const sf::Vector2f& end, float radius, const sf::Vector2f& boxCentre, const sf::Vector2f& boxHalfSize, float& t)
+{
+	// the set of positions where the circle touches the box is the box expanded by the radius with rounded corners
+	// so test the segment against the expanded box, and then against the rounded corner if it entered through one
+
+	// already touching at the start of the movement
+	sf::Vector2f closest{ Clamp(start.x, boxCentre.x - boxHalfSize.x, boxCentre.x + boxHalfSize.x),
+						  Clamp(start.y, boxCentre.y - boxHalfSize.y, boxCentre.y + boxHalfSize.y) };
+	if (SqrLength(start - closest) <= radius * radius)
+	{
+		t = 0.0f;
+		return true;
+	}
+
+	// slab test against the expanded box, clipped to the segment
+	sf::Vector2f d = end - start;
+	float tEnter = 0.0f, tExit = 1.0f;
+
+	const float s[2]{ start.x, start.y };
+	const float dir[2]{ d.x, d.y };
+	const float minBound[2]{ boxCentre.x - boxHalfSize.x - radius, boxCentre.y - boxHalfSize.y - radius };
+	const float maxBound[2]{ boxCentre.x + boxHalfSize.x + radius, boxCentre.y + boxHalfSize.y + radius };
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (dir[axis] == 0.0f)
+		{
+			// moving parallel to this slab, so must already be inside it
+			if (s[axis] < minBound[axis] || s[axis] > maxBound[axis]) return false;
+			continue;
+		}
+
+		float t1 = (minBound[axis] - s[axis]) / dir[axis];
+		float t2 = (maxBound[axis] - s[axis]) / dir[axis];
+		tEnter = std::max(tEnter, std::min(t1, t2));
+		tExit = std::min(tExit, std::max(t1, t2));
+		if (tEnter > tExit) return false;
+	}
+
+	// if the entry point is beside one of the faces of the box then it is a hit
+	sf::Vector2f p = start + d * tEnter;
+	bool besideX = std::fabs(p.x - boxCentre.x) <= boxHalfSize.x;
+	bool besideY = std::fabs(p.y - boxCentre.y) <= boxHalfSize.y;
+	if (besideX || besideY)
+	{
+		t = tEnter;
+		return true;
+	}
+
+	// otherwise it entered through a corner region; it only hits if it touches the rounded corner
+	sf::Vector2f corner{ boxCentre.x + (p.x > boxCentre.x ? boxHalfSize.x : -boxHalfSize.x),
+						 boxCentre.y + (p.y > boxCentre.y ? boxHalfSize.y : -boxHalfSize.y) };
+	return SweptCircleCircle(start, end, radius, corner, 0.0f, t);
+}
@@ -25,3 +25,8 @@ float LerpNoClamp(float a, float b, float t);
 sf::Vector2f LerpNoClamp(const sf::Vector2f& a, const sf::Vector2f& b, float t);
 
 float Smoothstep(float edge0, float edge1, float x);
+
+// swept collision tests for a circle of the given radius moving in a straight line from start to end
+// on a hit, t is set to the earliest point along the movement that contact occurs, in the range [0, 1]
+bool SweptCircleCircle(const sf::Vector2f& start, const sf::Vector2f& end, float radius, const sf::Vector2f& centre, float otherRadius, float& t);
+bool SweptCircleAABB(const sf::Vector2f& start, const sf::Vector2f& end, float radius, const sf::Vector2f& boxCentre, const sf::Vector2f& boxHalfSize, float& t);
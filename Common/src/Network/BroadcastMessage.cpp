@@ -0,0 +1,21 @@
+#include "BroadcastMessage.h"
+
+
+BroadcastMessage::BroadcastMessage(MessageCode code)
+{
+	Reset(code);
+}
+
+void BroadcastMessage::Reset(MessageCode code)
+{
+	// header is written with a placeholder client id
+	m_Packet.Clear();
+	m_Packet << MessageHeader{ INVALID_CLIENT_ID, code };
+}
+
+PacketWriter& BroadcastMessage::Address(ClientID recipient)
+{
+	// the client id is the first byte of the header
+	m_Packet.Overwrite(0, recipient);
+	return m_Packet;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "NetworkTypes.h"
+
+
+// a message that is serialised once and then sent to many clients
+// the only part of a message that differs between recipients is the client ID in the header,
+// so that single byte is rewritten in place for each recipient instead of re-serialising the whole message
+class BroadcastMessage
+{
+public:
+	explicit BroadcastMessage(MessageCode code);
+	template<typename T>
+	BroadcastMessage(MessageCode code, const T& body)
+		: BroadcastMessage(code)
+	{
+		m_Packet << body;
+	}
+
+	// start a new message, keeping hold of the memory already allocated
+	void Reset(MessageCode code);
+
+	// the body of the message is written straight into the packet after the header
+	inline PacketWriter& GetPacket() { return m_Packet; }
+
+	// rewrite the header for the next recipient
+	PacketWriter& Address(ClientID recipient);
+
+private:
+	PacketWriter m_Packet;
+};
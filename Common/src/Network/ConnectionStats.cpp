@@ -0,0 +1,133 @@
+#include "ConnectionStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+void ConnectionStats::OnSent(MessageCode code, size_t bytes)
+{
+	size_t index = static_cast<size_t>(code);
+	if (index >= NUM_MESSAGE_CODES) return;
+
+	m_Sent[index].packets++;
+	m_Sent[index].bytes += bytes;
+	m_TotalSent.packets++;
+	m_TotalSent.bytes += bytes;
+}
+
+void ConnectionStats::OnReceived(MessageCode code, size_t bytes)
+{
+	// the code comes from the other end, so it can't be trusted to be in range
+	size_t index = static_cast<size_t>(code);
+	if (index >= NUM_MESSAGE_CODES) return;
+
+	m_Received[index].packets++;
+	m_Received[index].bytes += bytes;
+	m_TotalReceived.packets++;
+	m_TotalReceived.bytes += bytes;
+}
+
+void ConnectionStats::OnSent(const PacketWriter& packet)
+{
+	// the message code follows the client id at the start of every message
+	if (packet.GetDataSize() < MessageHeader::WIRE_SIZE) return;
+	OnSent(static_cast<MessageCode>(packet.GetData()[1]), packet.GetDataSize());
+}
+
+void ConnectionStats::AddRttSample(float rtt)
+{
+	m_LastRtt = rtt;
+
+	if (m_RttSamples == 0)
+	{
+		m_SmoothedRtt = rtt;
+		m_RttVariance = 0.5f * rtt;
+	}
+	else
+	{
+		// the variance is updated first, against the previous smoothed value
+		m_RttVariance = 0.75f * m_RttVariance + 0.25f * std::fabs(m_SmoothedRtt - rtt);
+		m_SmoothedRtt = 0.875f * m_SmoothedRtt + 0.125f * rtt;
+	}
+
+	// the lowest round trip in the window, which only fills up over the first few samples
+	m_RecentRtts[m_RttSamples % RTT_MIN_FILTER_SAMPLES] = rtt;
+	unsigned int windowSize = std::min(m_RttSamples + 1, RTT_MIN_FILTER_SAMPLES);
+	float windowMin = *std::min_element(m_RecentRtts, m_RecentRtts + windowSize);
+
+	if (m_RttSamples == 0)
+		m_FilteredRtt = windowMin;
+	else
+		m_FilteredRtt = 0.875f * m_FilteredRtt + 0.125f * windowMin;
+
+	m_RttSamples++;
+}
+
+void ConnectionStats::OnSequenceReceived(sf::Uint16 sequence)
+{
+	if (!m_HasSequence)
+	{
+		m_HasSequence = true;
+		m_HighestSequence = sequence;
+		m_SequencedReceived++;
+		return;
+	}
+
+	sf::Int16 difference = static_cast<sf::Int16>(sequence - m_HighestSequence);
+	if (difference == 0)
+	{
+		// the network delivered the same datagram twice
+		m_Duplicates++;
+		return;
+	}
+
+	m_SequencedReceived++;
+	if (difference > 0)
+	{
+		// everything in between is missing, for now
+		m_SequencedLost += difference - 1;
+		m_HighestSequence = sequence;
+	}
+	else if (difference < 0 && m_SequencedLost > 0)
+	{
+		// one of the missing datagrams turned up after all
+		m_SequencedLost--;
+	}
+}
+
+void ConnectionStats::OnTransit(float sendTime, float receiveTime)
+{
+	float transit = receiveTime - sendTime;
+	if (m_HasTransit)
+	{
+		float difference = std::fabs(transit - m_LastTransit);
+		m_Jitter += (difference - m_Jitter) / 16.0f;
+	}
+
+	m_HasTransit = true;
+	m_LastTransit = transit;
+}
+
+void ConnectionStats::ResetCounters()
+{
+	for (size_t i = 0; i < NUM_MESSAGE_CODES; i++)
+	{
+		m_Sent[i] = MessageTraffic{};
+		m_Received[i] = MessageTraffic{};
+	}
+	m_TotalSent = MessageTraffic{};
+	m_TotalReceived = MessageTraffic{};
+
+	m_SequencedReceived = 0;
+	m_SequencedLost = 0;
+	m_OutOfOrder = 0;
+	m_Late = 0;
+	m_Duplicates = 0;
+	m_PingsLost = 0;
+}
+
+float ConnectionStats::GetLossRate() const
+{
+	unsigned int expected = m_SequencedReceived + m_SequencedLost;
+	return expected > 0 ? static_cast<float>(m_SequencedLost) / expected : 0.0f;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "NetworkTypes.h"
+#include "PacketWriter.h"
+
+#include <cstddef>
+
+
+// every message code, for indexing per-code arrays
+const size_t NUM_MESSAGE_CODES = static_cast<size_t>(MessageCode::WorldChunk) + 1;
+
+// the traffic of one message code in one direction
+struct MessageTraffic
+{
+	unsigned int packets = 0;
+	size_t bytes = 0; // message data, not counting the tcp/udp/ip headers or the tcp size prefix
+};
+
+
+// how a connection is performing, measured from one end of it
+// the counters cover a window, which the owner ends with ResetCounters whenever it reports them
+// the round trip, jitter and sequence tracking carry on across windows
+class ConnectionStats
+{
+public:
+	// count a message that has been sent or received
+	void OnSent(MessageCode code, size_t bytes);
+	void OnReceived(MessageCode code, size_t bytes);
+	// count a serialised message, reading its code from the header
+	void OnSent(const PacketWriter& packet);
+
+	// a round trip has been measured (seconds)
+	// smoothed the same way as tcp's retransmission timer (RFC 6298),
+	// and separately filtered into an estimate that is steady enough to compensate for latency with
+	void AddRttSample(float rtt);
+	// a ping went unanswered
+	inline void OnPingLost() { m_PingsLost++; }
+
+	// a datagram that is numbered in the order it was sent has arrived, for estimating how many went missing
+	// (datagrams that arrive late still count as received, so the estimate is for the ones that never turn up)
+	// a second copy of the newest datagram is counted as a duplicate instead
+	void OnSequenceReceived(sf::Uint16 sequence);
+	// a datagram arrived after a newer one
+	inline void OnOutOfOrder() { m_OutOfOrder++; }
+	// a datagram arrived too late to be of any use
+	inline void OnLate() { m_Late++; }
+	// a datagram was sent at sendTime by the other end's clock, and received at receiveTime by ours
+	// the clocks don't need to agree, as long as they run at the same rate
+	// smoothed the same way as rtp's interarrival jitter (RFC 3550)
+	void OnTransit(float sendTime, float receiveTime);
+
+	void ResetCounters();
+
+	inline const MessageTraffic& GetSent(MessageCode code) const { return m_Sent[static_cast<size_t>(code)]; }
+	inline const MessageTraffic& GetReceived(MessageCode code) const { return m_Received[static_cast<size_t>(code)]; }
+	inline const MessageTraffic& GetTotalSent() const { return m_TotalSent; }
+	inline const MessageTraffic& GetTotalReceived() const { return m_TotalReceived; }
+
+	// round trip times (seconds), 0 until the first has been measured
+	inline float GetLastRtt() const { return m_LastRtt; }
+	inline float GetSmoothedRtt() const { return m_SmoothedRtt; }
+	inline float GetRttVariance() const { return m_RttVariance; }
+	inline unsigned int GetRttSamples() const { return m_RttSamples; }
+	// the lowest of the last few round trips, smoothed
+	// queueing delays only ever add to a round trip, so the minimum ignores spikes that the smoothed rtt would follow
+	inline float GetFilteredRtt() const { return m_FilteredRtt; }
+
+	inline float GetJitter() const { return m_Jitter; }
+
+	// in the current window
+	inline unsigned int GetOutOfOrder() const { return m_OutOfOrder; }
+	inline unsigned int GetLate() const { return m_Late; }
+	inline unsigned int GetDuplicates() const { return m_Duplicates; }
+	inline unsigned int GetSequencedReceived() const { return m_SequencedReceived; }
+	inline unsigned int GetSequencedLost() const { return m_SequencedLost; }
+	inline unsigned int GetPingsLost() const { return m_PingsLost; }
+	// the fraction (0-1) of sequenced datagrams that went missing
+	float GetLossRate() const;
+
+private:
+	MessageTraffic m_Sent[NUM_MESSAGE_CODES];
+	MessageTraffic m_Received[NUM_MESSAGE_CODES];
+	MessageTraffic m_TotalSent;
+	MessageTraffic m_TotalReceived;
+
+	float m_LastRtt = 0.0f;
+	float m_SmoothedRtt = 0.0f;
+	float m_RttVariance = 0.0f;
+	unsigned int m_RttSamples = 0;
+	float m_RecentRtts[RTT_MIN_FILTER_SAMPLES] = {};
+	float m_FilteredRtt = 0.0f;
+
+	float m_Jitter = 0.0f;
+	bool m_HasTransit = false;
+	float m_LastTransit = 0.0f;
+
+	bool m_HasSequence = false;
+	sf::Uint16 m_HighestSequence = 0;
+	unsigned int m_SequencedReceived = 0;
+	unsigned int m_SequencedLost = 0;
+
+	unsigned int m_OutOfOrder = 0;
+	unsigned int m_Late = 0;
+	unsigned int m_Duplicates = 0;
+	unsigned int m_PingsLost = 0;
+};
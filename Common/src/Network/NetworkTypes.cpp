@@ -8,13 +8,13 @@
 
 // following is definitions of sf::Packet operator overloads for packing and unpacking packets
 
-sf::Packet& operator <<(sf::Packet& packet, const MessageCode& mc)
+PacketWriter& operator<<(PacketWriter& packet, const MessageCode& mc)
 {
-	CHECK_PACKET_ERROR(packet << static_cast<sf::Uint8>(mc));
+	packet << static_cast<sf::Uint8>(mc);
 	return packet;
 }
 
-sf::Packet& operator >>(sf::Packet& packet, MessageCode& mc)
+PacketReader& operator>>(PacketReader& packet, MessageCode& mc)
 {
 	sf::Uint8 mc_int;
 	CHECK_PACKET_ERROR(packet >> mc_int);
@@ -23,14 +23,43 @@ sf::Packet& operator >>(sf::Packet& packet, MessageCode& mc)
 	return packet;
 }
 
+const char* MessageCodeToStr(MessageCode mc)
+{
+	switch (mc)
+	{
+	case MessageCode::Connect:				return "Connect";
+	case MessageCode::Introduction:			return "Introduction";
+	case MessageCode::Disconnect:			return "Disconnect";
+	case MessageCode::PlayerConnected:		return "PlayerConnected";
+	case MessageCode::PlayerDisconnected:	return "PlayerDisconnected";
+	case MessageCode::Update:				return "Update";
+	case MessageCode::ChangeTeam:			return "ChangeTeam";
+	case MessageCode::ChangeGameState:		return "ChangeGameState";
+	case MessageCode::TurfLineMoved:		return "TurfLineMoved";
+	case MessageCode::Shoot:				return "Shoot";
+	case MessageCode::ShootRequestDenied:	return "ShootRequestDenied";
+	case MessageCode::Place:				return "Place";
+	case MessageCode::PlaceRequestDenied:	return "PlaceRequestDenied";
+	case MessageCode::GameStart:			return "GameStart";
+	case MessageCode::PlayerDeath:			return "PlayerDeath";
+	case MessageCode::ProjectilesDestroyed:	return "ProjectilesDestroyed";
+	case MessageCode::BlocksDestroyed:		return "BlocksDestroyed";
+	case MessageCode::GetServerTime:		return "GetServerTime";
+	case MessageCode::Ping:					return "Ping";
+	case MessageCode::WorldChunk:			return "WorldChunk";
+	default:								return "Unknown";
+	}
+}
 
-sf::Packet& operator<<(sf::Packet& packet, const MessageHeader& header)
+
+PacketWriter& operator<<(PacketWriter& packet, const MessageHeader& header)
 {
-	CHECK_PACKET_ERROR(packet << header.clientID << header.messageCode);
+	packet.Reserve(MessageHeader::WIRE_SIZE);
+	packet << header.clientID << header.messageCode;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, MessageHeader& header)
+PacketReader& operator>>(PacketReader& packet, MessageHeader& header)
 {
 	CHECK_PACKET_ERROR(packet >> header.clientID >> header.messageCode);
 	return packet;
@@ -42,47 +71,42 @@ MESSAGE BODIES
 */
 
 
-sf::Packet& operator<<(sf::Packet& packet, const IntroductionMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const IntroductionMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.udpPort);
+	packet.Reserve(IntroductionMessage::WIRE_SIZE);
+	packet << message.udpPort;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, IntroductionMessage& message)
+PacketReader& operator>>(PacketReader& packet, IntroductionMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.udpPort);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const ConnectMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const ConnectMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.playerNumber << message.team << message.numPlayers);
-
-	for (unsigned int i = 0; i < message.numPlayers; i++)
-		CHECK_PACKET_ERROR(packet << message.playerIDs[i] << message.playerTeams[i]);
+	packet << message.playerNumber << message.team;
 
-	CHECK_PACKET_ERROR(packet << message.numBlocks);
+	packet.WriteVarUint(static_cast<sf::Uint32>(message.players.size()));
+	for (const auto& player : message.players)
+		packet << player.id << player.team;
 
-	for (unsigned int i = 0; i < message.numBlocks; i++)
-		CHECK_PACKET_ERROR(packet << message.blockIDs[i] << message.blockTeams[i] << message.blockXs[i] << message.blockYs[i]);
-
-	CHECK_PACKET_ERROR(packet << message.gameState << message.remainingStateDuration << message.turfLine);
+	packet << message.gameState << message.remainingStateDuration << message.turfLine;
 
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, ConnectMessage& message)
+PacketReader& operator>>(PacketReader& packet, ConnectMessage& message)
 {
-	CHECK_PACKET_ERROR(packet >> message.playerNumber >> message.team >>  message.numPlayers);
-
-	for (unsigned int i = 0; i < message.numPlayers; i++)
-		CHECK_PACKET_ERROR(packet >> message.playerIDs[i] >> message.playerTeams[i]);
+	CHECK_PACKET_ERROR(packet >> message.playerNumber >> message.team);
 
-	CHECK_PACKET_ERROR(packet >> message.numBlocks);
-
-	for (unsigned int i = 0; i < message.numBlocks; i++)
-		CHECK_PACKET_ERROR(packet >> message.blockIDs[i] >> message.blockTeams[i] >> message.blockXs[i] >> message.blockYs[i]);
+	sf::Uint32 numPlayers = 0;
+	CHECK_PACKET_ERROR(packet.ReadVarUint(numPlayers, MAX_NUM_PLAYERS));
+	message.players.resize(numPlayers);
+	for (auto& player : message.players)
+		CHECK_PACKET_ERROR(packet >> player.id >> player.team);
 
 	CHECK_PACKET_ERROR(packet >> message.gameState >> message.remainingStateDuration >> message.turfLine);
 
@@ -90,147 +114,173 @@ sf::Packet& operator>>(sf::Packet& packet, ConnectMessage& message)
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const PlayerConnectedMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const PlayerConnectedMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.playerID << message.team);
+	packet.Reserve(PlayerConnectedMessage::WIRE_SIZE);
+	packet << message.playerID << message.team;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, PlayerConnectedMessage& message)
+PacketReader& operator>>(PacketReader& packet, PlayerConnectedMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.playerID >> message.team);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const PlayerDisconnectedMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const PlayerDisconnectedMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.playerID);
+	packet.Reserve(PlayerDisconnectedMessage::WIRE_SIZE);
+	packet << message.playerID;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, PlayerDisconnectedMessage& message)
+PacketReader& operator>>(PacketReader& packet, PlayerDisconnectedMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.playerID);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const UpdateMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const UpdateMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.playerID << message.x << message.y << message.rotation << message.dt << message.sendTime);
+	packet.Reserve(UpdateMessage::WIRE_SIZE);
+	packet << message.playerID << message.x << message.y << message.rotation << message.dt << message.sendTime << message.snapshotAck << message.sequence;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, UpdateMessage& message)
+PacketReader& operator>>(PacketReader& packet, UpdateMessage& message)
 {
-	CHECK_PACKET_ERROR(packet >> message.playerID >> message.x >> message.y >> message.rotation >> message.dt >> message.sendTime);
+	CHECK_PACKET_ERROR(packet >> message.playerID >> message.x >> message.y >> message.rotation >> message.dt >> message.sendTime >> message.snapshotAck >> message.sequence);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const ChangeTeamMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const ChangeTeamMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.playerID << message.team);
+	packet.Reserve(ChangeTeamMessage::WIRE_SIZE);
+	packet << message.playerID << message.team;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, ChangeTeamMessage& message)
+PacketReader& operator>>(PacketReader& packet, ChangeTeamMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.playerID >> message.team);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const ServerTimeMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const ServerTimeMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.serverTime);
+	packet.Reserve(ServerTimeMessage::WIRE_SIZE);
+	packet << message.serverTime;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, ServerTimeMessage& message)
+PacketReader& operator>>(PacketReader& packet, ServerTimeMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.serverTime);
 	return packet;
 }
 
+PacketWriter& operator<<(PacketWriter& packet, const PingMessage& message)
+{
+	packet.Reserve(PingMessage::WIRE_SIZE);
+	packet << message.sequence << message.sendTime << message.rtt;
+	return packet;
+}
+
+PacketReader& operator>>(PacketReader& packet, PingMessage& message)
+{
+	CHECK_PACKET_ERROR(packet >> message.sequence >> message.sendTime >> message.rtt);
+	return packet;
+}
+
 
-sf::Packet& operator<<(sf::Packet& packet, const ShootMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const ShootMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.id << message.shotBy << message.team << message.x << message.y << message.dirX << message.dirY << message.shootTime);
+	packet.Reserve(ShootMessage::WIRE_SIZE);
+	packet << message.id << message.shotBy << message.team << message.x << message.y << message.dirX << message.dirY << message.shootTime;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, ShootMessage& message)
+PacketReader& operator>>(PacketReader& packet, ShootMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.id >> message.shotBy >> message.team >> message.x >> message.y >> message.dirX >> message.dirY >> message.shootTime);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const ProjectilesDestroyedMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const ProjectilesDestroyedMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.count);
-	for (auto i = 0; i < message.count; i++) CHECK_PACKET_ERROR(packet << message.ids[i]);
+	packet.WriteVarUint(static_cast<sf::Uint32>(message.ids.size()));
+	for (auto id : message.ids) packet.WriteVarUint(id);
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, ProjectilesDestroyedMessage& message)
+PacketReader& operator>>(PacketReader& packet, ProjectilesDestroyedMessage& message)
 {
-	CHECK_PACKET_ERROR(packet >> message.count);
-	for (auto i = 0; i < message.count; i++) CHECK_PACKET_ERROR(packet >> message.ids[i]);
+	sf::Uint32 count = 0;
+	CHECK_PACKET_ERROR(packet.ReadVarUint(count, MAX_NUM_PROJECTILES));
+	message.ids.resize(count);
+	for (auto& id : message.ids) CHECK_PACKET_ERROR(packet.ReadVarUint(id));
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const PlaceMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const PlaceMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.id << message.placedBy << message.team << message.x << message.y);
+	packet.Reserve(PlaceMessage::WIRE_SIZE);
+	packet << message.id << message.placedBy << message.team << message.x << message.y;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, PlaceMessage& message)
+PacketReader& operator>>(PacketReader& packet, PlaceMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.id >> message.placedBy >> message.team >> message.x >> message.y);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const BlocksDestroyedMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const BlocksDestroyedMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.count);
-	for (auto i = 0; i < message.count; i++) CHECK_PACKET_ERROR(packet << message.ids[i]);
+	packet.WriteVarUint(static_cast<sf::Uint32>(message.ids.size()));
+	for (auto id : message.ids) packet.WriteVarUint(id);
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, BlocksDestroyedMessage& message)
+PacketReader& operator>>(PacketReader& packet, BlocksDestroyedMessage& message)
 {
-	CHECK_PACKET_ERROR(packet >> message.count);
-	for (auto i = 0; i < message.count; i++) CHECK_PACKET_ERROR(packet >> message.ids[i]);
+	sf::Uint32 count = 0;
+	CHECK_PACKET_ERROR(packet.ReadVarUint(count, MAX_NUM_BLOCKS));
+	message.ids.resize(count);
+	for (auto& id : message.ids) CHECK_PACKET_ERROR(packet.ReadVarUint(id));
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const ChangeGameStateMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const ChangeGameStateMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.state << message.stateDuration);
+	packet.Reserve(ChangeGameStateMessage::WIRE_SIZE);
+	packet << message.state << message.stateDuration;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, ChangeGameStateMessage& message)
+PacketReader& operator>>(PacketReader& packet, ChangeGameStateMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.state >> message.stateDuration);
 	return packet;
 }
 
 
-sf::Packet& operator<<(sf::Packet& packet, const TurfLineMoveMessage& message)
+PacketWriter& operator<<(PacketWriter& packet, const TurfLineMoveMessage& message)
 {
-	CHECK_PACKET_ERROR(packet << message.newTurfLine);
+	packet.Reserve(TurfLineMoveMessage::WIRE_SIZE);
+	packet << message.newTurfLine;
 	return packet;
 }
 
-sf::Packet& operator>>(sf::Packet& packet, TurfLineMoveMessage& message)
+PacketReader& operator>>(PacketReader& packet, TurfLineMoveMessage& message)
 {
 	CHECK_PACKET_ERROR(packet >> message.newTurfLine);
 	return packet;
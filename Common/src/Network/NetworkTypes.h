@@ -3,6 +3,9 @@
 #include "Constants.h"
 #include "CommonTypes.h"
 
+#include <cstddef>
+#include <vector>
+
 
 // a unique identifier assigned to a client
 using ClientID = sf::Uint8;
@@ -37,13 +40,19 @@ enum class MessageCode : sf::Uint8
 	BlocksDestroyed,		// Announce a block has been destroyed (S->C)
 	
 	GetServerTime,			// Calculate latency between client and server to update clients simulation timer (C<->S)
-	Ping					// Calculate a clients latency
+	Ping,					// Calculate a clients latency
+	WorldChunk				// Stream part of the world to a client that has just connected (S->C)
 };
-sf::Packet& operator <<(sf::Packet& packet, const MessageCode& mc);
-sf::Packet& operator >>(sf::Packet& packet, MessageCode& mc);
+PacketWriter& operator <<(PacketWriter& packet, const MessageCode& mc);
+PacketReader& operator >>(PacketReader& packet, MessageCode& mc);
+const char* MessageCodeToStr(MessageCode mc);
 
 
 // MESSAGE TYPES
+// messages that always serialise to the same number of bytes declare it as WIRE_SIZE,
+// so the packet writer only has to make room for them once
+// messages holding a list of objects store it in a vector and write its length (and the object ids) as varints,
+// so their size on the wire follows how many objects there are rather than how many there could be
 
 // a message header preceeds the data in every message
 // its important to identify who send the message, and what they want done with the data inside the message
@@ -51,30 +60,29 @@ struct MessageHeader
 {
 	ClientID clientID;
 	MessageCode messageCode;
+
+	static constexpr std::size_t WIRE_SIZE = 2;
 };
-sf::Packet& operator <<(sf::Packet& packet, const MessageHeader& header);
-sf::Packet& operator >>(sf::Packet& packet, MessageHeader& header);
+PacketWriter& operator <<(PacketWriter& packet, const MessageHeader& header);
+PacketReader& operator >>(PacketReader& packet, MessageHeader& header);
 
 
 // sent to a client after they connect,
 // and it describes the current state of the game when they join
 // so they can synchronize with the server
+// the blocks are not included, they follow in WorldChunk messages over the next few ticks
 struct ConnectMessage
 {
 	// info to be given to the newly joining player
 	sf::Uint8 playerNumber;
 	PlayerTeam team;
 	// info about the players already in the game
-	sf::Uint8 numPlayers;
-	ClientID playerIDs[MAX_NUM_PLAYERS];
-	PlayerTeam playerTeams[MAX_NUM_PLAYERS];
-	
-	// info about blocks already in game
-	sf::Uint8 numBlocks;
-	BlockID blockIDs[MAX_NUM_BLOCKS];
-	PlayerTeam blockTeams[MAX_NUM_BLOCKS];
-	float blockXs[MAX_NUM_BLOCKS];
-	float blockYs[MAX_NUM_BLOCKS];
+	struct PlayerInfo
+	{
+		ClientID id;
+		PlayerTeam team;
+	};
+	std::vector<PlayerInfo> players;
 
 	// info about the game state
 	GameState gameState;
@@ -82,36 +90,43 @@ struct ConnectMessage
 
 	float turfLine;
 };
-sf::Packet& operator <<(sf::Packet& packet, const ConnectMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, ConnectMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const ConnectMessage& message);
+PacketReader& operator >>(PacketReader& packet, ConnectMessage& message);
 
 // used for a client to tell the server how to contact them via udp
 struct IntroductionMessage
 {
 	sf::Uint16 udpPort;
+
+	static constexpr std::size_t WIRE_SIZE = 2;
 };
-sf::Packet& operator <<(sf::Packet& packet, const IntroductionMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, IntroductionMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const IntroductionMessage& message);
+PacketReader& operator >>(PacketReader& packet, IntroductionMessage& message);
 
 // informs aready connected players that a new player has connected
 struct PlayerConnectedMessage
 {
 	ClientID playerID;
 	PlayerTeam team;
+
+	static constexpr std::size_t WIRE_SIZE = 2;
 };
-sf::Packet& operator <<(sf::Packet& packet, const PlayerConnectedMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, PlayerConnectedMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const PlayerConnectedMessage& message);
+PacketReader& operator >>(PacketReader& packet, PlayerConnectedMessage& message);
 
 // informs all connected players that a player has disconnected
 struct PlayerDisconnectedMessage
 {
 	ClientID playerID;
+
+	static constexpr std::size_t WIRE_SIZE = 1;
 };
-sf::Packet& operator <<(sf::Packet& packet, const PlayerDisconnectedMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, PlayerDisconnectedMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const PlayerDisconnectedMessage& message);
+PacketReader& operator >>(PacketReader& packet, PlayerDisconnectedMessage& message);
 
-// contains all data about the current state of the player
+// contains all data about the current state of the player, sent from a client to the server
 // dt and sendTime are used for interpolating, predicting, and rewinding
+// (the server sends player state back out as delta-encoded snapshots, see Snapshot.h)
 struct UpdateMessage
 {
 	ClientID playerID; // the client that the update data pertains to
@@ -120,26 +135,47 @@ struct UpdateMessage
 	float rotation;
 	float dt;
 	float sendTime;
+	sf::Uint16 snapshotAck; // the most recent snapshot the client has received from the server
+	sf::Uint16 sequence; // counts up with every update the client sends, so the server can tell how many went missing
+
+	static constexpr std::size_t WIRE_SIZE = 1 + 5 * 4 + 2 + 2;
 };
-sf::Packet& operator <<(sf::Packet& packet, const UpdateMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, UpdateMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const UpdateMessage& message);
+PacketReader& operator >>(PacketReader& packet, UpdateMessage& message);
 
 // requests/confirms that a player has changed team
 struct ChangeTeamMessage
 {
 	ClientID playerID; // the client that changed team
 	PlayerTeam team; // their new team
+
+	static constexpr std::size_t WIRE_SIZE = 2;
 };
-sf::Packet& operator <<(sf::Packet& packet, const ChangeTeamMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, ChangeTeamMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const ChangeTeamMessage& message);
+PacketReader& operator >>(PacketReader& packet, ChangeTeamMessage& message);
 
 // the clients can ask the server for the current time so they can sync their clocks with the servers
 struct ServerTimeMessage
 {
 	float serverTime;
+
+	static constexpr std::size_t WIRE_SIZE = 4;
 };
-sf::Packet& operator <<(sf::Packet& packet, const ServerTimeMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, ServerTimeMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const ServerTimeMessage& message);
+PacketReader& operator >>(PacketReader& packet, ServerTimeMessage& message);
+
+// the server pings every client regularly to measure their latency, and the client sends the same message straight back
+// pings are numbered so that a reply can be matched to the ping it answers, even with several in flight or some lost
+struct PingMessage
+{
+	sf::Uint16 sequence;
+	float sendTime;	// server time the ping was sent
+	float rtt;		// the server's current estimate of the round trip time, for the client to show
+
+	static constexpr std::size_t WIRE_SIZE = 2 + 4 + 4;
+};
+PacketWriter& operator <<(PacketWriter& packet, const PingMessage& message);
+PacketReader& operator >>(PacketReader& packet, PingMessage& message);
 
 // request/confirmation that a projectile has been shot
 // contains all the data about the projectile being shot
@@ -153,18 +189,19 @@ struct ShootMessage
 	float dirX; // projectile direction
 	float dirY; 
 	float shootTime;
+
+	static constexpr std::size_t WIRE_SIZE = 4 + 1 + 1 + 5 * 4;
 };
-sf::Packet& operator <<(sf::Packet& packet, const ShootMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, ShootMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const ShootMessage& message);
+PacketReader& operator >>(PacketReader& packet, ShootMessage& message);
 
 // tells clients that a number of projectiles have been shot
 struct ProjectilesDestroyedMessage
 {
-	sf::Uint8 count;
-	ProjectileID ids[MAX_NUM_PROJECTILES]; // ids of the destroyed projectiles
+	std::vector<ProjectileID> ids; // ids of the destroyed projectiles
 };
-sf::Packet& operator <<(sf::Packet& packet, const ProjectilesDestroyedMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, ProjectilesDestroyedMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const ProjectilesDestroyedMessage& message);
+PacketReader& operator >>(PacketReader& packet, ProjectilesDestroyedMessage& message);
 
 // request/confirm that a block has been placed
 struct PlaceMessage
@@ -174,35 +211,40 @@ struct PlaceMessage
 	PlayerTeam team;
 	float x;
 	float y;
+
+	static constexpr std::size_t WIRE_SIZE = 4 + 1 + 1 + 2 * 4;
 };
-sf::Packet& operator <<(sf::Packet& packet, const PlaceMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, PlaceMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const PlaceMessage& message);
+PacketReader& operator >>(PacketReader& packet, PlaceMessage& message);
 
 // inform clients that one or more blocks have been destroyed
 struct BlocksDestroyedMessage
 {
-	sf::Uint8 count;
-	BlockID ids[MAX_NUM_BLOCKS]; // the ids of the destroyed blocks
+	std::vector<BlockID> ids; // the ids of the destroyed blocks
 };
-sf::Packet& operator <<(sf::Packet& packet, const BlocksDestroyedMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, BlocksDestroyedMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const BlocksDestroyedMessage& message);
+PacketReader& operator >>(PacketReader& packet, BlocksDestroyedMessage& message);
 
 // inform clients the game state has changed
 struct ChangeGameStateMessage
 {
 	GameState state;
 	float stateDuration;
+
+	static constexpr std::size_t WIRE_SIZE = 1 + 4;
 };
-sf::Packet& operator <<(sf::Packet& packet, const ChangeGameStateMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, ChangeGameStateMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const ChangeGameStateMessage& message);
+PacketReader& operator >>(PacketReader& packet, ChangeGameStateMessage& message);
 
 // inform clients the turf line has moved
 struct TurfLineMoveMessage
 {
 	float newTurfLine;
+
+	static constexpr std::size_t WIRE_SIZE = 4;
 };
-sf::Packet& operator <<(sf::Packet& packet, const TurfLineMoveMessage& message);
-sf::Packet& operator >>(sf::Packet& packet, TurfLineMoveMessage& message);
+PacketWriter& operator <<(PacketWriter& packet, const TurfLineMoveMessage& message);
+PacketReader& operator >>(PacketReader& packet, TurfLineMoveMessage& message);
 
 
 // a record of the players state at a certain moment in time
@@ -210,10 +252,11 @@ sf::Packet& operator >>(sf::Packet& packet, TurfLineMoveMessage& message);
 struct PlayerStateFrame
 {
 	sf::Vector2f position;
-	float rotation;
-	float dt;
-	float sendTimestamp; // used for ordering player state frames
+	float rotation = 0.0f;
+	float dt = 0.0f;
+	float sendTimestamp = 0.0f; // used for ordering player state frames
 
+	PlayerStateFrame() = default;
 	PlayerStateFrame(const UpdateMessage& m)
 	{
 		position.x = m.x;
@@ -0,0 +1,105 @@
+#include "PacketReader.h"
+
+#include <cstring>
+
+
+PacketReader::PacketReader(const void* data, std::size_t size)
+	: m_Data(static_cast<const unsigned char*>(data)), m_Size(size)
+{
+}
+
+PacketReader::PacketReader(const sf::Packet& packet)
+	: PacketReader(packet.getData(), packet.getDataSize())
+{
+}
+
+bool PacketReader::Read(void* data, std::size_t size)
+{
+	m_Valid = m_Valid && (m_ReadPosition + size <= m_Size);
+	if (!m_Valid) return false;
+
+	std::memcpy(data, m_Data + m_ReadPosition, size);
+	m_ReadPosition += size;
+	return true;
+}
+
+// integers are read big-endian, the same as sf::Packet
+
+PacketReader& PacketReader::operator>>(bool& data)
+{
+	sf::Uint8 value;
+	if (*this >> value) data = (value != 0);
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(sf::Int8& data)
+{
+	Read(&data, sizeof(data));
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(sf::Uint8& data)
+{
+	Read(&data, sizeof(data));
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(sf::Int16& data)
+{
+	sf::Uint16 value;
+	if (*this >> value) data = static_cast<sf::Int16>(value);
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(sf::Uint16& data)
+{
+	unsigned char bytes[2];
+	if (Read(bytes, sizeof(bytes)))
+		data = static_cast<sf::Uint16>((bytes[0] << 8) | bytes[1]);
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(sf::Int32& data)
+{
+	sf::Uint32 value;
+	if (*this >> value) data = static_cast<sf::Int32>(value);
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(sf::Uint32& data)
+{
+	unsigned char bytes[4];
+	if (Read(bytes, sizeof(bytes)))
+		data = (static_cast<sf::Uint32>(bytes[0]) << 24) | (static_cast<sf::Uint32>(bytes[1]) << 16) | (static_cast<sf::Uint32>(bytes[2]) << 8) | bytes[3];
+	return *this;
+}
+
+PacketReader& PacketReader::operator>>(float& data)
+{
+	// sf::Packet writes floats as they are in memory
+	Read(&data, sizeof(data));
+	return *this;
+}
+
+PacketReader& PacketReader::ReadVarUint(sf::Uint32& data, sf::Uint32 max)
+{
+	sf::Uint32 value = 0;
+	for (unsigned int shift = 0; shift < 35; shift += 7)
+	{
+		sf::Uint8 byte;
+		if (!Read(&byte, sizeof(byte))) return *this;
+
+		value |= static_cast<sf::Uint32>(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			// the fifth byte can only hold the top 4 bits of a 32 bit value
+			m_Valid = (shift < 28 || byte < 0x10) && value <= max;
+			if (m_Valid) data = value;
+			return *this;
+		}
+	}
+
+	// more than 5 bytes is not something WriteVarUint would have written
+	m_Valid = false;
+	return *this;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SFML/Network/Packet.hpp>
+
+#include <cstddef>
+
+
+// reads data written in the sf::Packet format out of a buffer that it doesn't own
+// like sf::Packet, reading past the end of the data invalidates the reader and leaves the value untouched
+class PacketReader
+{
+public:
+	PacketReader(const void* data, std::size_t size);
+	explicit PacketReader(const sf::Packet& packet);
+
+	inline bool EndOfPacket() const { return m_ReadPosition >= m_Size; }
+	inline explicit operator bool() const { return m_Valid; }
+
+	bool Read(void* data, std::size_t size);
+
+	PacketReader& operator >>(bool& data);
+	PacketReader& operator >>(sf::Int8& data);
+	PacketReader& operator >>(sf::Uint8& data);
+	PacketReader& operator >>(sf::Int16& data);
+	PacketReader& operator >>(sf::Uint16& data);
+	PacketReader& operator >>(sf::Int32& data);
+	PacketReader& operator >>(sf::Uint32& data);
+	PacketReader& operator >>(float& data);
+
+	// read an integer written with PacketWriter::WriteVarUint
+	// a value larger than max invalidates the reader, so counts can be checked before anything is allocated for them
+	PacketReader& ReadVarUint(sf::Uint32& data, sf::Uint32 max = 0xFFFFFFFF);
+
+private:
+	const unsigned char* m_Data;
+	std::size_t m_Size;
+	std::size_t m_ReadPosition = 0;
+	bool m_Valid = true;
+};
@@ -0,0 +1,107 @@
+#include "PacketWriter.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+PacketWriter::PacketWriter(std::size_t initialCapacity)
+{
+	m_Buffer.resize(SIZE_PREFIX_BYTES + initialCapacity);
+}
+
+void PacketWriter::Write(const void* data, std::size_t size)
+{
+	if (size == 0) return;
+
+	Reserve(size);
+	std::memcpy(m_Buffer.data() + m_Size, data, size);
+	m_Size += size;
+}
+
+void PacketWriter::Overwrite(std::size_t offset, sf::Uint8 value)
+{
+	assert(offset < GetDataSize() && "Overwriting past the end of the message!");
+	m_Buffer[SIZE_PREFIX_BYTES + offset] = static_cast<char>(value);
+}
+
+// integers are written big-endian, the same as sf::Packet
+
+PacketWriter& PacketWriter::operator<<(bool data)
+{
+	return *this << static_cast<sf::Uint8>(data);
+}
+
+PacketWriter& PacketWriter::operator<<(sf::Int8 data)
+{
+	Write(&data, sizeof(data));
+	return *this;
+}
+
+PacketWriter& PacketWriter::operator<<(sf::Uint8 data)
+{
+	Write(&data, sizeof(data));
+	return *this;
+}
+
+PacketWriter& PacketWriter::operator<<(sf::Int16 data)
+{
+	return *this << static_cast<sf::Uint16>(data);
+}
+
+PacketWriter& PacketWriter::operator<<(sf::Uint16 data)
+{
+	char bytes[2] = { static_cast<char>(data >> 8), static_cast<char>(data) };
+	Write(bytes, sizeof(bytes));
+	return *this;
+}
+
+PacketWriter& PacketWriter::operator<<(sf::Int32 data)
+{
+	return *this << static_cast<sf::Uint32>(data);
+}
+
+PacketWriter& PacketWriter::operator<<(sf::Uint32 data)
+{
+	char bytes[4] = { static_cast<char>(data >> 24), static_cast<char>(data >> 16), static_cast<char>(data >> 8), static_cast<char>(data) };
+	Write(bytes, sizeof(bytes));
+	return *this;
+}
+
+PacketWriter& PacketWriter::operator<<(float data)
+{
+	// sf::Packet writes floats as they are in memory
+	Write(&data, sizeof(data));
+	return *this;
+}
+
+PacketWriter& PacketWriter::WriteVarUint(sf::Uint32 data)
+{
+	char bytes[5];
+	std::size_t count = 0;
+	while (data >= 0x80)
+	{
+		bytes[count++] = static_cast<char>((data & 0x7F) | 0x80);
+		data >>= 7;
+	}
+	bytes[count++] = static_cast<char>(data);
+
+	Write(bytes, count);
+	return *this;
+}
+
+const char* PacketWriter::GetTcpFrame(std::size_t& size)
+{
+	sf::Uint32 dataSize = static_cast<sf::Uint32>(GetDataSize());
+	m_Buffer[0] = static_cast<char>(dataSize >> 24);
+	m_Buffer[1] = static_cast<char>(dataSize >> 16);
+	m_Buffer[2] = static_cast<char>(dataSize >> 8);
+	m_Buffer[3] = static_cast<char>(dataSize);
+
+	size = m_Size;
+	return m_Buffer.data();
+}
+
+void PacketWriter::Grow(std::size_t bytes)
+{
+	m_Buffer.resize(std::max(m_Buffer.size() * 2, m_Size + bytes));
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+
+// serialises data in exactly the same format as sf::Packet, into a buffer that is reused between messages
+// once the buffer has grown to fit the largest message it is used for, writing a message never allocates
+//
+// the buffer always begins with room for the 4 byte size that sf::TcpSocket puts in front of every packet,
+// so a finished message can be sent over tcp as is (and received as an sf::Packet on the other end),
+// or over udp from just after the size
+class PacketWriter
+{
+public:
+	explicit PacketWriter(std::size_t initialCapacity = DEFAULT_CAPACITY);
+
+	// start a new message, keeping hold of the buffer
+	inline void Clear() { m_Size = SIZE_PREFIX_BYTES; }
+
+	// make sure there is room for this many more bytes, so a fixed size message only checks capacity once
+	inline void Reserve(std::size_t bytes) { if (m_Size + bytes > m_Buffer.size()) Grow(bytes); }
+
+	void Write(const void* data, std::size_t size);
+	// rewrite a single byte of the message that has already been written
+	void Overwrite(std::size_t offset, sf::Uint8 value);
+
+	PacketWriter& operator <<(bool data);
+	PacketWriter& operator <<(sf::Int8 data);
+	PacketWriter& operator <<(sf::Uint8 data);
+	PacketWriter& operator <<(sf::Int16 data);
+	PacketWriter& operator <<(sf::Uint16 data);
+	PacketWriter& operator <<(sf::Int32 data);
+	PacketWriter& operator <<(sf::Uint32 data);
+	PacketWriter& operator <<(float data);
+
+	// write an unsigned integer in as few bytes as it needs, 7 bits per byte with the top bit set if more bytes follow
+	// values under 128 take a single byte, and any 32 bit value at most 5
+	PacketWriter& WriteVarUint(sf::Uint32 data);
+
+	// the message data, as it would be sent over udp
+	inline const char* GetData() const { return m_Buffer.data() + SIZE_PREFIX_BYTES; }
+	inline std::size_t GetDataSize() const { return m_Size - SIZE_PREFIX_BYTES; }
+
+	// the message data with the tcp size prefix filled in
+	const char* GetTcpFrame(std::size_t& size);
+
+private:
+	void Grow(std::size_t bytes);
+
+private:
+	static const std::size_t SIZE_PREFIX_BYTES = 4;
+	// big enough for a header and any of the fixed size messages
+	static const std::size_t DEFAULT_CAPACITY = 64;
+
+	// sized to the capacity; m_Size is how much of it is in use
+	std::vector<char> m_Buffer;
+	std::size_t m_Size = SIZE_PREFIX_BYTES;
+};
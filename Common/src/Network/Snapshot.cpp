@@ -0,0 +1,144 @@
+#include "Snapshot.h"
+
+#include "Log.h"
+#include "MathUtils.h"
+
+#include <cmath>
+
+// validates that packet packing/unpacking was successful
+#define CHECK_PACKET_ERROR(v) CHECK_ERROR(v, "Packet operation failed!")
+
+
+// flags describing which fields of a player follow in a snapshot delta
+enum PlayerSnapshotField : sf::Uint8
+{
+	FieldX			= 1 << 0,
+	FieldY			= 1 << 1,
+	FieldRotation	= 1 << 2,
+	FieldRemoved	= 1 << 3	// the player is no longer in the game
+};
+
+
+static sf::Uint16 QuantiseRange(float value, float max)
+{
+	float t = Clamp(value / max, 0.0f, 1.0f);
+	return static_cast<sf::Uint16>(std::lround(t * 65535.0f));
+}
+
+void PlayerSnapshot::Quantise(const sf::Vector2f& position, float rotationDegrees)
+{
+	present = true;
+	x = QuantiseRange(position.x, WORLD_WIDTH);
+	y = QuantiseRange(position.y, WORLD_HEIGHT);
+
+	// wrap the rotation into a single turn, so that 360 degrees maps back to 0
+	float turn = rotationDegrees / 360.0f;
+	turn -= std::floor(turn);
+	rotation = static_cast<sf::Uint8>(std::lround(turn * 256.0f) & 0xFF);
+}
+
+sf::Vector2f PlayerSnapshot::GetPosition() const
+{
+	return { WORLD_WIDTH * x / 65535.0f, WORLD_HEIGHT * y / 65535.0f };
+}
+
+float PlayerSnapshot::GetRotation() const
+{
+	return 360.0f * rotation / 256.0f;
+}
+
+
+void Snapshot::Clear(SnapshotSequence newSequence, float time)
+{
+	sequence = newSequence;
+	serverTime = time;
+	for (auto& player : players) player = PlayerSnapshot{};
+}
+
+
+PacketWriter& operator<<(PacketWriter& packet, const SnapshotHeader& header)
+{
+	packet.Reserve(SnapshotHeader::WIRE_SIZE);
+	return packet << header.sequence << header.baseline << header.serverTime << header.sendTime;
+}
+
+PacketReader& operator>>(PacketReader& packet, SnapshotHeader& header)
+{
+	CHECK_PACKET_ERROR(packet >> header.sequence >> header.baseline >> header.serverTime >> header.sendTime);
+	return packet;
+}
+
+
+void WriteSnapshotDelta(PacketWriter& packet, const Snapshot& snapshot, const Snapshot* baseline)
+{
+	static const PlayerSnapshot s_EmptyPlayer;
+
+	// work out which players need to be written
+	sf::Uint8 masks[MAX_CLIENT_ID + 1];
+	sf::Uint8 count = 0;
+	for (ClientID id = 0; id <= MAX_CLIENT_ID; id++)
+	{
+		const PlayerSnapshot& current = snapshot.players[id];
+		const PlayerSnapshot& previous = baseline ? baseline->players[id] : s_EmptyPlayer;
+
+		sf::Uint8 mask = 0;
+		if (current != previous)
+		{
+			if (!current.present)
+				mask = FieldRemoved;
+			else if (!previous.present)
+				mask = FieldX | FieldY | FieldRotation;
+			else
+			{
+				if (current.x != previous.x) mask |= FieldX;
+				if (current.y != previous.y) mask |= FieldY;
+				if (current.rotation != previous.rotation) mask |= FieldRotation;
+			}
+		}
+
+		masks[id] = mask;
+		if (mask) count++;
+	}
+
+	// write the changed players
+	packet << count;
+	for (ClientID id = 0; id <= MAX_CLIENT_ID; id++)
+	{
+		sf::Uint8 mask = masks[id];
+		if (!mask) continue;
+
+		const PlayerSnapshot& current = snapshot.players[id];
+		packet << id << mask;
+		if (mask & FieldX) packet << current.x;
+		if (mask & FieldY) packet << current.y;
+		if (mask & FieldRotation) packet << current.rotation;
+	}
+}
+
+bool ReadSnapshotDelta(PacketReader& packet, Snapshot& snapshot)
+{
+	sf::Uint8 count;
+	if (!(packet >> count)) return false;
+
+	for (auto i = 0; i < count; i++)
+	{
+		ClientID id;
+		sf::Uint8 mask;
+		if (!(packet >> id >> mask) || id > MAX_CLIENT_ID) return false;
+
+		PlayerSnapshot& player = snapshot.players[id];
+		if (mask & FieldRemoved)
+		{
+			player = PlayerSnapshot{};
+			continue;
+		}
+
+		player.present = true;
+		if (mask & FieldX) packet >> player.x;
+		if (mask & FieldY) packet >> player.y;
+		if (mask & FieldRotation) packet >> player.rotation;
+	}
+
+	// reading past the end of the packet invalidates it
+	return static_cast<bool>(packet);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "NetworkTypes.h"
+
+
+// snapshots are numbered with a 16 bit sequence number that wraps around
+using SnapshotSequence = sf::Uint16;
+// sequence 0 is never used for a snapshot, so it is used to mean 'no snapshot'
+const SnapshotSequence NO_SNAPSHOT = 0;
+// how many snapshots the server and clients keep hold of to delta-encode against
+// if a client hasn't acknowledged a snapshot within this many updates, it is sent a full snapshot instead
+const SnapshotSequence SNAPSHOT_BUFFER_SIZE = 32;
+
+// is sequence a more recent than sequence b, taking wrap around into account
+inline bool SequenceMoreRecent(SnapshotSequence a, SnapshotSequence b) { return static_cast<sf::Int16>(a - b) > 0; }
+
+
+// a player's state, quantised to the precision that is sent over the network
+// positions use the full 16 bit range over the world bounds, rotation uses 8 bits over a full turn
+struct PlayerSnapshot
+{
+	bool present = false;
+	sf::Uint16 x = 0;
+	sf::Uint16 y = 0;
+	sf::Uint8 rotation = 0;
+
+	void Quantise(const sf::Vector2f& position, float rotationDegrees);
+	sf::Vector2f GetPosition() const;
+	float GetRotation() const;
+
+	inline bool operator==(const PlayerSnapshot& other) const { return present == other.present && x == other.x && y == other.y && rotation == other.rotation; }
+	inline bool operator!=(const PlayerSnapshot& other) const { return !(*this == other); }
+};
+
+// the state of every player at a single server update
+// players are indexed by their client ID
+struct Snapshot
+{
+	SnapshotSequence sequence = NO_SNAPSHOT;
+	float serverTime = 0.0f;
+	PlayerSnapshot players[MAX_CLIENT_ID + 1];
+
+	void Clear(SnapshotSequence newSequence, float time);
+};
+
+
+// preceeds the player data in an update message sent from the server
+struct SnapshotHeader
+{
+	SnapshotSequence sequence;
+	SnapshotSequence baseline; // the snapshot the player data is relative to, or NO_SNAPSHOT if it is a full snapshot
+	float serverTime;
+	float sendTime; // the server's real time when it was sent, for measuring jitter (the server time moves with the simulation)
+
+	static constexpr std::size_t WIRE_SIZE = 2 + 2 + 4 + 4;
+};
+PacketWriter& operator <<(PacketWriter& packet, const SnapshotHeader& header);
+PacketReader& operator >>(PacketReader& packet, SnapshotHeader& header);
+
+// write the players that differ between the snapshot and the baseline
+// players that haven't changed aren't written at all, and only the fields that have changed are written for the rest
+// if baseline is null then every present player is written in full
+// the output only depends on the snapshot and baseline, so it can be shared between every client that acknowledged the same baseline
+void WriteSnapshotDelta(PacketWriter& packet, const Snapshot& snapshot, const Snapshot* baseline);
+// apply the player data from a packet to a snapshot
+// the snapshot should already contain a copy of the baseline the data was encoded against
+bool ReadSnapshotDelta(PacketReader& packet, Snapshot& snapshot);
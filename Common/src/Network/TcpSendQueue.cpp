@@ -0,0 +1,60 @@
+#include "TcpSendQueue.h"
+
+
+TcpSendQueue::TcpSendQueue(std::size_t softLimit, std::size_t hardLimit)
+	: m_SoftLimit(softLimit), m_HardLimit(hardLimit)
+{
+	// enough for a burst of messages in a single tick without growing
+	m_Buffer.reserve(1024);
+}
+
+bool TcpSendQueue::Push(PacketWriter& packet)
+{
+	std::size_t size;
+	const char* frame = packet.GetTcpFrame(size);
+
+	if (Size() + size > m_HardLimit)
+	{
+		m_Overflowed = true;
+		return false;
+	}
+
+	// reclaim the space taken up by data that has already been sent before growing
+	if (m_SentBytes > 0 && m_Buffer.size() + size > m_Buffer.capacity())
+	{
+		m_Buffer.erase(m_Buffer.begin(), m_Buffer.begin() + m_SentBytes);
+		m_SentBytes = 0;
+	}
+
+	m_Buffer.insert(m_Buffer.end(), frame, frame + size);
+	return true;
+}
+
+sf::Socket::Status TcpSendQueue::Flush(sf::TcpSocket& socket)
+{
+	if (Empty()) return sf::Socket::Done;
+
+	// a non-blocking send writes as much as it can and reports how much that was
+	std::size_t sent = 0;
+	sf::Socket::Status status = socket.send(m_Buffer.data() + m_SentBytes, Size(), sent);
+	m_SentBytes += sent;
+
+	if (Empty())
+	{
+		// keep hold of the memory for next time
+		m_Buffer.clear();
+		m_SentBytes = 0;
+		return sf::Socket::Done;
+	}
+
+	// anything that wasn't sent waits for the next flush
+	// (Done with data left over can't happen, but treat it as partial)
+	return status == sf::Socket::Done ? sf::Socket::Partial : status;
+}
+
+void TcpSendQueue::Clear()
+{
+	m_Buffer.clear();
+	m_SentBytes = 0;
+	m_Overflowed = false;
+}
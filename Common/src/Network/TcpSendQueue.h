@@ -0,0 +1,44 @@
+#pragma once
+
+#include "PacketWriter.h"
+
+#include <SFML/Network/TcpSocket.hpp>
+
+#include <vector>
+
+
+// a bounded queue of framed messages waiting to be sent over a non-blocking tcp socket
+// flushing writes as much as the socket will take right now, and anything it won't take stays queued for the next flush,
+// so a receiver that can't keep up never stalls the sender
+//
+// once the queue grows past its soft limit the connection is backlogged,
+// and past its hard limit new messages are refused and the connection should be dropped
+class TcpSendQueue
+{
+public:
+	TcpSendQueue(std::size_t softLimit, std::size_t hardLimit);
+
+	// queue a message, returns false (and drops the message) if it would take the queue past its hard limit
+	bool Push(PacketWriter& packet);
+
+	// write as much of the queue to the socket as it will accept
+	// returns Done if the queue was emptied, Partial/NotReady if some of it is still waiting, or the socket error
+	sf::Socket::Status Flush(sf::TcpSocket& socket);
+
+	// throw away everything queued (e.g. when the socket has been disconnected)
+	void Clear();
+
+	inline bool Empty() const { return Size() == 0; }
+	inline std::size_t Size() const { return m_Buffer.size() - m_SentBytes; }
+	inline bool Backlogged() const { return Size() > m_SoftLimit; }
+	inline bool Overflowed() const { return m_Overflowed; }
+
+private:
+	// framed messages back to back, the first m_SentBytes of which have already been sent
+	std::vector<char> m_Buffer;
+	std::size_t m_SentBytes = 0;
+
+	std::size_t m_SoftLimit;
+	std::size_t m_HardLimit;
+	bool m_Overflowed = false;
+};
@@ -0,0 +1,64 @@
+#include "WorldChunk.h"
+
+#include "Log.h"
+
+#include <cmath>
+
+// validates that packet packing/unpacking was successful
+#define CHECK_PACKET_ERROR(v) CHECK_ERROR(v, "Packet operation failed!")
+
+
+int BlockGridWidth()
+{
+	return static_cast<int>(std::round(WORLD_WIDTH / BLOCK_SIZE)) + 1;
+}
+
+int BlockGridHeight()
+{
+	return static_cast<int>(std::round(WORLD_HEIGHT / BLOCK_SIZE)) + 1;
+}
+
+sf::Vector2f BlockCellPosition(sf::Uint32 cell)
+{
+	sf::Uint32 width = static_cast<sf::Uint32>(BlockGridWidth());
+	return { BLOCK_SIZE * (cell % width), BLOCK_SIZE * (cell / width) };
+}
+
+
+PacketWriter& operator<<(PacketWriter& packet, const WorldChunkMessage& message)
+{
+	packet.WriteVarUint(message.startCell);
+	packet.WriteVarUint(static_cast<sf::Uint32>(message.blocks.size()));
+
+	sf::Uint32 previousCell = message.startCell;
+	for (const auto& block : message.blocks)
+	{
+		packet.WriteVarUint(block.cell - previousCell).WriteVarUint(block.id) << block.team;
+		previousCell = block.cell;
+	}
+
+	packet << message.last;
+	return packet;
+}
+
+PacketReader& operator>>(PacketReader& packet, WorldChunkMessage& message)
+{
+	const sf::Uint32 cells = BlockGridCells();
+
+	sf::Uint32 count = 0;
+	CHECK_PACKET_ERROR(packet.ReadVarUint(message.startCell, cells - 1).ReadVarUint(count, MAX_NUM_BLOCKS));
+
+	message.blocks.resize(count);
+	sf::Uint32 previousCell = message.startCell;
+	for (auto& block : message.blocks)
+	{
+		// every block has to land inside the grid
+		sf::Uint32 gap = 0;
+		CHECK_PACKET_ERROR(packet.ReadVarUint(gap, cells - previousCell - 1).ReadVarUint(block.id) >> block.team);
+		block.cell = previousCell + gap;
+		previousCell = block.cell;
+	}
+
+	CHECK_PACKET_ERROR(packet >> message.last);
+	return packet;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "NetworkTypes.h"
+
+
+// blocks always sit on grid points, which lie on multiples of BLOCK_SIZE including both edges of the world
+// cells are numbered row by row, so a cell index identifies a block position in a single integer
+int BlockGridWidth();
+int BlockGridHeight();
+inline sf::Uint32 BlockGridCells() { return static_cast<sf::Uint32>(BlockGridWidth()) * BlockGridHeight(); }
+sf::Vector2f BlockCellPosition(sf::Uint32 cell);
+
+
+// a piece of the world sent to a client that has just joined
+// the blocks are streamed over several ticks instead of all at once inside the connect message,
+// each chunk continues from the cell the previous one stopped at
+struct WorldChunkMessage
+{
+	struct BlockInfo
+	{
+		sf::Uint32 cell;
+		BlockID id;
+		PlayerTeam team;
+	};
+
+	sf::Uint32 startCell = 0;		// the first cell covered by this chunk
+	std::vector<BlockInfo> blocks;	// in increasing cell order
+	bool last = false;				// this is the final chunk, the client now has the whole world
+};
+// blocks are written as the number of cells since the previous block, so runs of empty cells cost a single varint
+PacketWriter& operator <<(PacketWriter& packet, const WorldChunkMessage& message);
+PacketReader& operator >>(PacketReader& packet, WorldChunkMessage& message);
@@ -0,0 +1,197 @@
+#include "Trace.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <fstream>
+
+
+namespace
+{
+	// events are stored in blocks, so a buffer can grow without moving what has already been recorded
+	const size_t EVENTS_PER_BLOCK = 4096;
+	// about 80MB per thread at most
+	const size_t MAX_EVENTS_PER_THREAD = 1024 * 1024;
+
+	struct TraceEvent
+	{
+		const char* name;
+		sf::Int64 begin;
+		sf::Int64 duration;
+		TraceArg args[Trace::MAX_ARGS];
+		unsigned int numArgs;
+	};
+
+	struct TraceBlock
+	{
+		TraceEvent events[EVENTS_PER_BLOCK];
+		// set by the recording thread before any event in the next block is published
+		std::atomic<TraceBlock*> next{ nullptr };
+	};
+
+	// the events recorded by a single thread
+	// only the owning thread writes events, and publishes them by advancing count,
+	// so Flush can read everything before count without stopping it
+	struct ThreadBuffer
+	{
+		unsigned int threadID = 0;
+		std::atomic<const char*> name{ nullptr };
+
+		TraceBlock* first = nullptr;
+		TraceBlock* current = nullptr;	// only touched by the recording thread
+		std::atomic<size_t> count{ 0 };
+		std::atomic<size_t> dropped{ 0 };
+	};
+
+	// every thread's buffer, kept until the process exits so that Flush never reads a buffer that has gone
+	// the lock is only taken when a thread records its first event, and by Flush
+	std::mutex s_BuffersMutex;
+	std::vector<ThreadBuffer*> s_Buffers;
+
+	thread_local ThreadBuffer* t_Buffer = nullptr;
+
+	sf::Clock& TraceClock()
+	{
+		// started by the first event
+		static sf::Clock clock;
+		return clock;
+	}
+
+	ThreadBuffer* GetThreadBuffer()
+	{
+		if (t_Buffer) return t_Buffer;
+
+		ThreadBuffer* buffer = new ThreadBuffer;
+		buffer->first = new TraceBlock;
+		buffer->current = buffer->first;
+
+		std::lock_guard<std::mutex> lock(s_BuffersMutex);
+		buffer->threadID = static_cast<unsigned int>(s_Buffers.size());
+		s_Buffers.push_back(buffer);
+
+		t_Buffer = buffer;
+		return buffer;
+	}
+
+	void WriteJsonString(std::ofstream& file, const char* str)
+	{
+		file << '"';
+		for (const char* c = str; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') file << '\\';
+			file << *c;
+		}
+		file << '"';
+	}
+}
+
+
+sf::Int64 Trace::Now()
+{
+	return TraceClock().getElapsedTime().asMicroseconds();
+}
+
+void Trace::Complete(const char* name, sf::Int64 begin, sf::Int64 duration, const TraceArg* args, unsigned int numArgs)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	size_t count = buffer->count.load(std::memory_order_relaxed);
+	if (count == MAX_EVENTS_PER_THREAD)
+	{
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	size_t index = count % EVENTS_PER_BLOCK;
+	if (index == 0 && count > 0)
+	{
+		// the current block is full
+		TraceBlock* block = new TraceBlock;
+		buffer->current->next.store(block, std::memory_order_release);
+		buffer->current = block;
+	}
+
+	TraceEvent& event = buffer->current->events[index];
+	event.name = name;
+	event.begin = begin;
+	event.duration = duration;
+	event.numArgs = numArgs < MAX_ARGS ? numArgs : MAX_ARGS;
+	for (unsigned int i = 0; i < event.numArgs; i++)
+		event.args[i] = args[i];
+
+	// publish the event
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	GetThreadBuffer()->name.store(name, std::memory_order_release);
+}
+
+bool Trace::Flush(const std::string& filename)
+{
+	std::vector<ThreadBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(s_BuffersMutex);
+		buffers = s_Buffers;
+	}
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file) return false;
+
+	size_t dropped = 0;
+	bool first = true;
+
+	file << "{\"traceEvents\":[\n";
+	for (auto buffer : buffers)
+	{
+		const char* name = buffer->name.load(std::memory_order_acquire);
+		if (name)
+		{
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadID << ",\"args\":{\"name\":";
+			WriteJsonString(file, name);
+			file << "}}";
+			first = false;
+		}
+
+		// everything before count has been completely written
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		TraceBlock* block = buffer->first;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (i > 0 && i % EVENTS_PER_BLOCK == 0)
+				block = block->next.load(std::memory_order_acquire);
+
+			const TraceEvent& event = block->events[i % EVENTS_PER_BLOCK];
+			file << (first ? "" : ",\n") << "{\"name\":";
+			WriteJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"ts\":" << event.begin << ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << buffer->threadID;
+			first = false;
+
+			if (event.numArgs > 0)
+			{
+				file << ",\"args\":{";
+				for (unsigned int a = 0; a < event.numArgs; a++)
+				{
+					const TraceArg& arg = event.args[a];
+					if (a > 0) file << ',';
+					WriteJsonString(file, arg.name);
+					file << ':';
+					if (arg.str)
+						WriteJsonString(file, arg.str);
+					else
+						file << arg.value;
+				}
+				file << '}';
+			}
+			file << '}';
+		}
+
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	file << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+
+	return static_cast<bool>(file);
+}
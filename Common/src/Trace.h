@@ -0,0 +1,95 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+#include <string>
+
+
+// timeline tracing, written out in the chrome trace event format (open the file in chrome://tracing or ui.perfetto.dev)
+// add ENABLE_TRACING to a project's preprocessor definitions to turn it on, otherwise the TRACE_ macros compile to nothing
+//
+// every thread records into its own buffer, which only that thread writes to, so recording never locks
+// buffers grow in blocks up to a limit, after which events are dropped: tracing is meant for capturing a few minutes at a time
+
+
+// a value attached to an event
+// names and string values aren't copied, so they must outlive the trace (string literals, or the ToStr functions)
+struct TraceArg
+{
+	TraceArg() = default;
+	TraceArg(const char* name, sf::Int64 value) : name(name), value(value) {}
+	TraceArg(const char* name, const char* str) : name(name), str(str) {}
+
+	const char* name = nullptr;
+	sf::Int64 value = 0;
+	const char* str = nullptr; // used instead of the value if set
+};
+
+
+class Trace
+{
+public:
+	static const unsigned int MAX_ARGS = 2;
+
+	// microseconds since the first event was recorded, shared by every thread
+	static sf::Int64 Now();
+
+	// record an event that has finished
+	static void Complete(const char* name, sf::Int64 begin, sf::Int64 duration, const TraceArg* args = nullptr, unsigned int numArgs = 0);
+	// label the calling thread in the trace viewer
+	static void SetThreadName(const char* name);
+
+	// write everything every thread has recorded so far
+	// can be called at any time from any thread, while the others carry on recording
+	// returns false if the file couldn't be written
+	static bool Flush(const std::string& filename);
+};
+
+
+// records an event covering the scope it is declared in
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name)
+		: m_Name(name), m_Begin(Trace::Now())
+	{
+	}
+	TraceScope(const char* name, const TraceArg& arg0)
+		: m_Name(name), m_Begin(Trace::Now()), m_NumArgs(1)
+	{
+		m_Args[0] = arg0;
+	}
+	TraceScope(const char* name, const TraceArg& arg0, const TraceArg& arg1)
+		: m_Name(name), m_Begin(Trace::Now()), m_NumArgs(2)
+	{
+		m_Args[0] = arg0;
+		m_Args[1] = arg1;
+	}
+	~TraceScope() { Trace::Complete(m_Name, m_Begin, Trace::Now() - m_Begin, m_Args, m_NumArgs); }
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* m_Name;
+	sf::Int64 m_Begin;
+	TraceArg m_Args[Trace::MAX_ARGS];
+	unsigned int m_NumArgs = 0;
+};
+
+
+#ifdef ENABLE_TRACING
+	#define TRACE_CONCAT_INNER(a, b)	a##b
+	#define TRACE_CONCAT(a, b)			TRACE_CONCAT_INNER(a, b)
+
+	// TRACE_SCOPE(name) or TRACE_SCOPE(name, TraceArg{...}, TraceArg{...})
+	#define TRACE_SCOPE(...)							::TraceScope TRACE_CONCAT(traceScope, __LINE__){ __VA_ARGS__ }
+	// an event that ended just now and lasted duration microseconds
+	#define TRACE_COMPLETE(name, duration)				::Trace::Complete(name, ::Trace::Now() - (duration), duration)
+	#define TRACE_THREAD_NAME(name)						::Trace::SetThreadName(name)
+	#define TRACE_FLUSH(filename)						::Trace::Flush(filename)
+#else
+	#define TRACE_SCOPE(...)
+	#define TRACE_COMPLETE(name, duration)
+	#define TRACE_THREAD_NAME(name)
+	#define TRACE_FLUSH(filename)
+#endif
@@ -0,0 +1,91 @@
+#include "BlockGrid.h"
+
+#include "Constants.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+BlockGrid::BlockGrid()
+{
+	// grid points lie on multiples of BLOCK_SIZE, including both edges of the world
+	// clients share the same layout, so blocks can be sent to them by cell
+	m_Width = BlockGridWidth();
+	m_Height = BlockGridHeight();
+	m_Cells.resize(static_cast<size_t>(m_Width) * m_Height, INVALID_OBJECT_HANDLE);
+}
+
+bool BlockGrid::Insert(ObjectHandle block, const sf::Vector2f& position)
+{
+	int x, y;
+	if (!CellAt(position, x, y)) return false;
+
+	ObjectHandle& cell = m_Cells[CellIndex(x, y)];
+	if (cell != INVALID_OBJECT_HANDLE) return false;
+
+	cell = block;
+	return true;
+}
+
+void BlockGrid::Remove(ObjectHandle block, const sf::Vector2f& position)
+{
+	int x, y;
+	if (!CellAt(position, x, y)) return;
+
+	// only clear the cell if it actually belongs to this block
+	ObjectHandle& cell = m_Cells[CellIndex(x, y)];
+	if (cell == block) cell = INVALID_OBJECT_HANDLE;
+}
+
+void BlockGrid::Clear()
+{
+	std::fill(m_Cells.begin(), m_Cells.end(), INVALID_OBJECT_HANDLE);
+}
+
+ObjectHandle BlockGrid::At(const sf::Vector2f& position) const
+{
+	int x, y;
+	if (!CellAt(position, x, y)) return INVALID_OBJECT_HANDLE;
+	return m_Cells[CellIndex(x, y)];
+}
+
+void BlockGrid::QueryArea(const sf::Vector2f& min, const sf::Vector2f& max, std::vector<ObjectHandle>& results) const
+{
+	results.clear();
+
+	// the block in cell i covers [i * BLOCK_SIZE - 0.5 * BLOCK_SIZE, i * BLOCK_SIZE + 0.5 * BLOCK_SIZE]
+	// so work out the range of cells whose blocks overlap the area
+	int x0 = std::max(0, static_cast<int>(std::ceil((min.x - 0.5f * BLOCK_SIZE) / BLOCK_SIZE)));
+	int y0 = std::max(0, static_cast<int>(std::ceil((min.y - 0.5f * BLOCK_SIZE) / BLOCK_SIZE)));
+	int x1 = std::min(m_Width - 1, static_cast<int>(std::floor((max.x + 0.5f * BLOCK_SIZE) / BLOCK_SIZE)));
+	int y1 = std::min(m_Height - 1, static_cast<int>(std::floor((max.y + 0.5f * BLOCK_SIZE) / BLOCK_SIZE)));
+
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			ObjectHandle block = m_Cells[CellIndex(x, y)];
+			if (block != INVALID_OBJECT_HANDLE) results.push_back(block);
+		}
+	}
+}
+
+void BlockGrid::QuerySweptCircle(const sf::Vector2f& start, const sf::Vector2f& end, float radius, std::vector<ObjectHandle>& results) const
+{
+	// the bounding box of the swept circle
+	sf::Vector2f min{ std::min(start.x, end.x) - radius, std::min(start.y, end.y) - radius };
+	sf::Vector2f max{ std::max(start.x, end.x) + radius, std::max(start.y, end.y) + radius };
+	QueryArea(min, max, results);
+}
+
+sf::Vector2f BlockGrid::Snap(const sf::Vector2f& position)
+{
+	return { BLOCK_SIZE * std::round(position.x / BLOCK_SIZE), BLOCK_SIZE * std::round(position.y / BLOCK_SIZE) };
+}
+
+bool BlockGrid::CellAt(const sf::Vector2f& position, int& x, int& y) const
+{
+	x = static_cast<int>(std::round(position.x / BLOCK_SIZE));
+	y = static_cast<int>(std::round(position.y / BLOCK_SIZE));
+	return x >= 0 && x < m_Width && y >= 0 && y < m_Height;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <vector>
+
+#include "GameObjects.h"
+#include "Network/WorldChunk.h"
+
+
+// a dense occupancy grid covering the world, with one cell per BLOCK_SIZE square
+// blocks are always placed on grid points so each cell holds at most one block
+// this allows collision queries to only look at the blocks near a position instead of every block
+// cells hold handles into the server's BlockPool, which stay valid as the pool reorders its blocks
+class BlockGrid
+{
+public:
+	BlockGrid();
+	~BlockGrid() = default;
+
+	// add/remove a block from the cell at its position
+	// insert fails if the position is outside the world or the cell is already occupied
+	bool Insert(ObjectHandle block, const sf::Vector2f& position);
+	void Remove(ObjectHandle block, const sf::Vector2f& position);
+	void Clear();
+
+	// get the block occupying the cell at a position (or INVALID_OBJECT_HANDLE if it is empty)
+	ObjectHandle At(const sf::Vector2f& position) const;
+
+	// find all blocks whose bounds overlap the area between min and max
+	// results is cleared first so that the caller can reuse the same vector every query
+	void QueryArea(const sf::Vector2f& min, const sf::Vector2f& max, std::vector<ObjectHandle>& results) const;
+	// find all blocks that could be touched by a circle moving from start to end
+	void QuerySweptCircle(const sf::Vector2f& start, const sf::Vector2f& end, float radius, std::vector<ObjectHandle>& results) const;
+
+	// cells are numbered the same way as in WorldChunkMessage, so they can be walked in order to stream the world
+	inline sf::Uint32 NumCells() const { return static_cast<sf::Uint32>(m_Cells.size()); }
+	inline ObjectHandle AtCell(sf::Uint32 cell) const { return m_Cells[cell]; }
+
+	// round a position to the nearest grid point
+	static sf::Vector2f Snap(const sf::Vector2f& position);
+
+private:
+	// convert a position to the cell that contains it
+	// returns false if the position is outside of the grid
+	bool CellAt(const sf::Vector2f& position, int& x, int& y) const;
+	inline size_t CellIndex(int x, int y) const { return static_cast<size_t>(y) * m_Width + x; }
+
+private:
+	int m_Width = 0;
+	int m_Height = 0;
+	std::vector<ObjectHandle> m_Cells;
+};
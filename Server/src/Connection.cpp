@@ -1,10 +1,11 @@
 #include "Connection.h"
 
 #include "Log.h"
-#include "MathUtils.h"
+#include "Trace.h"
 
 
 Connection::Connection()
+	: m_SendQueue(TCP_SEND_QUEUE_SOFT_LIMIT, TCP_SEND_QUEUE_HARD_LIMIT)
 {
 	// set up tcp socket
 	m_Socket.setBlocking(false);
@@ -18,88 +19,73 @@ Connection::~Connection()
 sf::Vector2f Connection::GetPastPlayerPos(float t)
 {
 	// rewind time through the players state history
-
 	assert(t < STATE_HISTORY_DURATION && "Can't see that far into the past");
+	return GetPlayerPosAtTime(GetCurrentPlayerState().sendTimestamp - t);
+}
 
-	// find out which two states in the history t is between
-	float t0 = 0.0f;
-	size_t frameIndex = 0;
-	for (auto& frame : m_PlayerStateHistory)
-	{
-		// does the next frame take us too far back
-		if (t0 + frame.dt > t) break;
+sf::Vector2f Connection::GetPlayerPosAtTime(float timestamp)
+{
+	return m_PlayerStateHistory.PositionAtTime(timestamp);
+}
 
-		t0 += frame.dt;
-		frameIndex++;
+void Connection::AddToStateQueue(const UpdateMessage& updateMessage)
+{
+	if (!m_PlayerStateHistory.Empty())
+	{
+		// udp can deliver updates out of order
+		// one that is older than anything lag compensation can rewind to has arrived too late to matter
+		float newest = m_PlayerStateHistory.Newest().sendTimestamp;
+		if (updateMessage.sendTime < newest)
+			m_Stats.OnOutOfOrder();
+		if (updateMessage.sendTime < newest - MAX_LAG_COMPENSATION)
+			m_Stats.OnLate();
 	}
 
-	// now we need to interpolate between frames in the history
-	PlayerStateFrame& frame0 = m_PlayerStateHistory[frameIndex];
-	PlayerStateFrame& frame1 = m_PlayerStateHistory[frameIndex + 1];
+	// add a new update to the player state history
+	// (player updates are sent via udp so could be recieved out of order,
+	//	the history places them by send timestamp)
+	m_PlayerStateHistory.Insert(PlayerStateFrame{ updateMessage });
 
-	// how much to interpolate?
-	float interpolation = (t - t0) / frame0.dt;
-	return Lerp(frame0.position, frame1.position, interpolation);
+	// remove any history older than we will ever need to rewind to
+	m_PlayerStateHistory.Trim(STATE_HISTORY_DURATION);
 }
 
-void Connection::AddToStateQueue(const UpdateMessage& updateMessage)
+PingMessage Connection::BeginPing(float t)
 {
-	// add a new update to the player state queue
-	PlayerStateFrame newStateFrame{ updateMessage };
+	// the slot is reused every MAX_PINGS_IN_FLIGHT pings, whatever was in it has been waiting too long
+	PendingPing& ping = m_Pings[m_NextPingSequence % MAX_PINGS_IN_FLIGHT];
+	if (ping.inFlight)
+		m_Stats.OnPingLost();
 
-	// we need to work out where to place it in the queue
-	// this is done by comparing the send timestamps of the frames
-	// (player updates are sent via udp so could be recieved out of order,
-	//	so we must order them upon receive)
+	ping.sequence = m_NextPingSequence++;
+	ping.sendTime = t;
+	ping.inFlight = true;
 
-	auto it = m_PlayerStateHistory.begin();
-	for (; it != m_PlayerStateHistory.end(); it++)
-	{
-		PlayerStateFrame& f = *it;
-		if (newStateFrame.sendTimestamp > f.sendTimestamp)
-		{
-			it = m_PlayerStateHistory.insert(it, newStateFrame);
-			break;
-		}
-	}
-	if (it == m_PlayerStateHistory.end())
-		m_PlayerStateHistory.push_back(newStateFrame);
+	// keep to the schedule, unless the server has fallen so far behind that pings would go out back to back
+	m_NextPingTime += PING_FREQUENCY;
+	if (m_NextPingTime <= t)
+		m_NextPingTime = t + PING_FREQUENCY;
 
-	float historyDuration = CalculateHistoryDuration();
-	// work out how much extra history is currently stored
-	float dt = std::max(0.0f, historyDuration - STATE_HISTORY_DURATION);
+	return PingMessage{ ping.sequence, ping.sendTime, GetLatency() };
+}
 
-	// remove all of the extra history
-	while (m_PlayerStateHistory.size() > 1 && dt > 0)
-	{
-		PlayerStateFrame& oldest = m_PlayerStateHistory.back();
-		if (dt >= oldest.dt)
-		{
-			// we can remove this entire frame
-			dt -= oldest.dt;
-			m_PlayerStateHistory.pop_back();
-		}
-		else
-		{
-			// we have to cut this frame short
-			// assume the player travelled at a constant velocity during this frame
-			float t = dt / oldest.dt;
-
-			// interpolate between the second oldest and oldest to correctly trim the history
-			PlayerStateFrame& secondOldest = m_PlayerStateHistory[m_PlayerStateHistory.size() - 2];
-			oldest.position = Lerp(oldest.position, secondOldest.position, t);
-			oldest.rotation = LerpAngleDegrees(oldest.rotation, secondOldest.rotation, t);
-			oldest.dt = dt;
-			break;
-		}
-	}
+bool Connection::OnPingReply(const PingMessage& reply, float t)
+{
+	// the send time has to match as well, so an old reply can't be taken for a newer ping in the same slot
+	PendingPing& ping = m_Pings[reply.sequence % MAX_PINGS_IN_FLIGHT];
+	if (!ping.inFlight || ping.sequence != reply.sequence || ping.sendTime != reply.sendTime)
+		return false;
+
+	ping.inFlight = false;
+	m_Stats.AddRttSample(t - ping.sendTime);
+	return true;
 }
 
-void Connection::OnTcpConnected(ClientID id, sf::Uint8 playerNum)
+void Connection::OnTcpConnected(ClientID id)
 {
 	// update state upon connection
+	// the player number is decided by the room the client joins
 	m_ID = id;
-	m_PlayerNumber = playerNum;
 	m_TcpPort = m_Socket.getLocalPort();
 	m_ClientIP = m_Socket.getRemoteAddress();
 }
@@ -109,31 +95,45 @@ void Connection::SetUdpPort(unsigned short clientPort)
 	m_UdpPort = clientPort;
 }
 
-void Connection::SendPacketTcp(sf::Packet& packet)
+void Connection::SendPacketTcp(PacketWriter& packet)
 {
-	// send a packet to the client via tcp
-	sf::Socket::Status status;
-	do
+	// the message code follows the client id at the start of every message
+	TRACE_SCOPE("Connection::SendPacketTcp", TraceArg{ "client", m_ID },
+		TraceArg{ "code", packet.GetDataSize() >= MessageHeader::WIRE_SIZE ? MessageCodeToStr(static_cast<MessageCode>(packet.GetData()[1])) : "None" });
+
+	// queue a packet to be sent to the client via tcp
+	// each message keeps its own sf::Packet framing, so the client receives them one at a time as usual
+	if (m_SendQueue.Push(packet))
 	{
-		status = m_Socket.send(packet);
-		// repeatedly send until the entire message has been sent
-	} while (status == sf::Socket::Partial);
+		m_QueuedTcpMessages++;
+		m_Stats.OnSent(packet);
+	}
+}
 
-	if (status != sf::Socket::Done)
-		LOG_ERROR("Error sending packet to client!");
+void Connection::SendBroadcastTcp(BroadcastMessage& message)
+{
+	SendPacketTcp(message.Address(m_ID));
 }
 
-void Connection::SendMessageTcp(MessageCode code)
+sf::Socket::Status Connection::FlushTcp()
 {
-	sf::Packet packet;
-	MessageHeader header{ m_ID, code };
-	packet << header;
-	SendPacketTcp(packet);
+	TRACE_SCOPE("Connection::FlushTcp", TraceArg{ "client", m_ID }, TraceArg{ "messages", m_QueuedTcpMessages });
+
+	m_QueuedTcpMessages = 0;
+
+	// the socket is non-blocking, so whatever it won't take now stays queued rather than holding up the server
+	sf::Socket::Status status = m_SendQueue.Flush(m_Socket);
+	if (status == sf::Socket::Error || status == sf::Socket::Disconnected)
+	{
+		// nothing more can be sent
+		m_SendQueue.Clear();
+	}
+	return status;
 }
 
-float Connection::CalculateHistoryDuration()
+void Connection::SendMessageTcp(MessageCode code)
 {
-	float duration = 0.0f;
-	for (auto& frame : m_PlayerStateHistory) duration += frame.dt;
-	return duration;
+	m_SendPacket.Clear();
+	m_SendPacket << MessageHeader{ m_ID, code };
+	SendPacketTcp(m_SendPacket);
 }
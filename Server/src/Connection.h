@@ -1,8 +1,12 @@
 #pragma once
 
 #include "Network\NetworkTypes.h"
+#include "Network\Snapshot.h"
+#include "Network\BroadcastMessage.h"
+#include "Network\TcpSendQueue.h"
+#include "Network\ConnectionStats.h"
+#include "PlayerStateHistory.h"
 
-#include <deque>
 #include <cassert>
 
 
@@ -18,6 +22,7 @@ public:
 	inline ClientID GetID() const { return m_ID; }
 	
 	inline sf::Uint8 GetPlayerNumber() const { return m_PlayerNumber; }
+	inline void SetPlayerNumber(sf::Uint8 playerNum) { m_PlayerNumber = playerNum; }
 	inline PlayerTeam GetPlayerTeam() const { return m_PlayerTeam; }
 	inline void SetPlayerTeam(PlayerTeam team) { m_PlayerTeam = team; }
 
@@ -27,51 +32,106 @@ public:
 
 	// check if the server is able to send to the client via udp yet
 	inline bool CanSendUdp() const { return m_UdpPort != (unsigned short)(-1); }
+	// check a datagram claiming to be from this client actually came from them
+	// the port is only known once the client has introduced itself, until then only the address can be checked
+	inline bool IsUdpSource(const sf::IpAddress& address, unsigned short port) const { return address == m_ClientIP && (!CanSendUdp() || port == m_UdpPort); }
 
 	// manipulate and read the players state queue
-	inline bool StateQueueEmpty() const { return m_PlayerStateHistory.empty(); }
-	inline PlayerStateFrame& GetCurrentPlayerState() { assert(m_PlayerStateHistory.size() > 0 && "State history is empty!");  return m_PlayerStateHistory[0]; }
-	// get the player's state t seconds ago
+	inline bool StateQueueEmpty() const { return m_PlayerStateHistory.Empty(); }
+	inline PlayerStateFrame& GetCurrentPlayerState() { assert(!m_PlayerStateHistory.Empty() && "State history is empty!");  return m_PlayerStateHistory.Newest(); }
+	// get the player's position t seconds before their most recent state
 	sf::Vector2f GetPastPlayerPos(float t);
+	// get the player's position at a point in time, interpolating between the states either side of it
+	// this is a binary search over the history so is cheap enough to be done per projectile
+	sf::Vector2f GetPlayerPosAtTime(float timestamp);
+	// get the area the player could be found in by GetPlayerPosAtTime for any timestamp from the one given onwards
+	inline void GetPlayerBoundsSince(float timestamp, sf::Vector2f& min, sf::Vector2f& max) const { m_PlayerStateHistory.BoundsSince(timestamp, min, max); }
 	void AddToStateQueue(const UpdateMessage& updateMessage);
 
+	// the most recent snapshot the client has told us it received, used as the baseline for the updates we send it
+	inline SnapshotSequence GetAckedSnapshot() const { return m_AckedSnapshot; }
+	inline void AcknowledgeSnapshot(SnapshotSequence sequence)
+	{
+		// acks can arrive out of order, only ever move forwards
+		if (sequence == NO_SNAPSHOT) return;
+		if (m_AckedSnapshot == NO_SNAPSHOT || SequenceMoreRecent(sequence, m_AckedSnapshot)) m_AckedSnapshot = sequence;
+	}
+
+	// streaming the world to a client that has just joined
+	// only blocks with an id below the limit are streamed, anything placed since the client joined reaches it as a normal Place message
+	inline void BeginWorldStream(BlockID idLimit) { m_StreamingWorld = true; m_WorldStreamCell = 0; m_WorldStreamIDLimit = idLimit; }
+	inline void EndWorldStream() { m_StreamingWorld = false; }
+	inline bool IsStreamingWorld() const { return m_StreamingWorld; }
+	inline sf::Uint32 GetWorldStreamCell() const { return m_WorldStreamCell; }
+	inline void SetWorldStreamCell(sf::Uint32 cell) { m_WorldStreamCell = cell; }
+	inline BlockID GetWorldStreamIDLimit() const { return m_WorldStreamIDLimit; }
+
 	// has the player ready-ed up
 	inline bool IsReady() const { return m_Ready; }
 	inline void SetReady(bool ready) { m_Ready = ready; }
 
 	// set up the sockets
-	void OnTcpConnected(ClientID id, sf::Uint8 playerNum);
+	void OnTcpConnected(ClientID id);
 	void SetUdpPort(unsigned short clientPort);
 
 	// send data to client, additional overloads for convenience
-	void SendPacketTcp(sf::Packet& packet);
+	// reliable messages are queued up as they are sent during a tick,
+	// and go out together when the connection is flushed
+	void SendPacketTcp(PacketWriter& packet);
 	void SendMessageTcp(MessageCode code);
 	template<typename T>
-	void SendMessageTcp(MessageCode code, T& message)
+	void SendMessageTcp(MessageCode code, const T& message)
 	{
-		sf::Packet packet;
-		MessageHeader header{ m_ID, code };
-		packet << header << message;
+		m_SendPacket.Clear();
+		m_SendPacket << MessageHeader{ m_ID, code } << message;
 
-		SendPacketTcp(packet);
+		SendPacketTcp(m_SendPacket);
 	}
-
-	// helper functions for calculating latency
-	inline void BeginPing(float t) { m_BeginPingTime = t; }
-	inline void CalculateLatency(float t) { m_Latency = t - m_BeginPingTime; }
-	inline float GetLatency() const { return m_Latency; }
+	// send a message that has already been serialised for every client
+	void SendBroadcastTcp(BroadcastMessage& message);
+
+	// send as much of the queued data as the socket will take without blocking
+	sf::Socket::Status FlushTcp();
+	inline bool HasQueuedTcp() const { return !m_SendQueue.Empty(); }
+	inline unsigned int GetQueuedTcpMessages() const { return m_QueuedTcpMessages; }
+	inline size_t GetQueuedTcpBytes() const { return m_SendQueue.Size(); }
+	// the client isn't receiving as fast as we are sending
+	inline bool IsSendBacklogged() const { return m_SendQueue.Backlogged(); }
+	// so much is queued that messages have been dropped, the connection is no longer consistent
+	inline bool HasSendOverflowed() const { return m_SendQueue.Overflowed(); }
+	// forget anything that hasn't been sent yet
+	inline void DiscardQueuedTcp() { m_SendQueue.Clear(); m_QueuedTcpMessages = 0; }
+
+	// latency is measured with numbered pings, several of which can be in flight at once
+	// the first ping goes out at firstPingTime, then one every PING_FREQUENCY
+	inline void SchedulePings(float firstPingTime) { m_NextPingTime = firstPingTime; }
+	inline bool IsPingDue(float t) const { return t >= m_NextPingTime; }
+	inline float GetNextPingTime() const { return m_NextPingTime; }
+	// start a ping at time t, returns the message to send
+	PingMessage BeginPing(float t);
+	// a ping reply arrived at time t
+	// returns false if it doesn't answer a ping that is still in flight (a duplicate, or one already given up on)
+	bool OnPingReply(const PingMessage& reply, float t);
+	// the round trip time, filtered so that it doesn't jump about with every ping
+	inline float GetLatency() const { return m_Stats.GetFilteredRtt(); }
+
+	// traffic and connection quality, updated by the room the client is in
+	inline ConnectionStats& GetStats() { return m_Stats; }
+	inline const ConnectionStats& GetStats() const { return m_Stats; }
 
 	// functions for manipulating the idle timer
 	inline float GetIdleTimer() const { return m_IdleTimer; }
 	inline void IncreaseIdleTimer(float dt) { m_IdleTimer += dt; }
 	inline void ResetIdleTimer() { m_IdleTimer = 0.0f; }
 
-private:
-
-	float CalculateHistoryDuration();
-
 private:
 	sf::TcpSocket m_Socket;
+	// reused for every message sent to this client
+	PacketWriter m_SendPacket;
+	// messages waiting to be sent
+	TcpSendQueue m_SendQueue;
+	// messages queued since the last flush
+	unsigned int m_QueuedTcpMessages = 0;
 
 	// network properties
 	ClientID m_ID = INVALID_CLIENT_ID;
@@ -81,14 +141,29 @@ private:
 	unsigned short m_TcpPort = -1;
 	unsigned short m_UdpPort = -1;
 
-	float m_BeginPingTime = 0.0f;
-	float m_Latency = 0.0f;
+	// the pings in flight, indexed by sequence number
+	struct PendingPing
+	{
+		sf::Uint16 sequence = 0;
+		float sendTime = 0.0f;
+		bool inFlight = false;
+	};
+	PendingPing m_Pings[MAX_PINGS_IN_FLIGHT];
+	sf::Uint16 m_NextPingSequence = 0;
+	float m_NextPingTime = 0.0f;
+	ConnectionStats m_Stats;
 
 	float m_IdleTimer = 0.0f;
 
 	// in-game player properties
 	PlayerTeam m_PlayerTeam = PlayerTeam::None;
-	std::deque<PlayerStateFrame> m_PlayerStateHistory;
+	PlayerStateHistory m_PlayerStateHistory;
+	SnapshotSequence m_AckedSnapshot = NO_SNAPSHOT;
+
+	// the next cell of the block grid to stream to the client
+	bool m_StreamingWorld = false;
+	sf::Uint32 m_WorldStreamCell = 0;
+	BlockID m_WorldStreamIDLimit = 0;
 
 	// ready for game to start
 	bool m_Ready = false;
@@ -3,81 +3,165 @@
 #include "MathUtils.h"
 
 
-BlockState::BlockState(PlaceMessage placeMessage)
+// remove an element by moving the last element into its place
+template<typename T>
+static inline void SwapAndPop(std::vector<T>& v, size_t index)
 {
-	id = placeMessage.id;
-	team = placeMessage.team;
-	position = { placeMessage.x, placeMessage.y };
+	v[index] = v.back();
+	v.pop_back();
 }
-BlockState::BlockState(BlockID _id, PlayerTeam _team, const sf::Vector2f& _position)
+
+
+BlockPool::BlockPool(size_t capacity)
 {
-	id = _id;
-	team = _team;
-	position = _position;
+	m_HandleTable.Reserve(capacity);
+	m_Handles.reserve(capacity);
+	m_IDs.reserve(capacity);
+	m_Teams.reserve(capacity);
+	m_PositionX.reserve(capacity);
+	m_PositionY.reserve(capacity);
 }
 
-
-ProjectileState::ProjectileState(ShootMessage shootMessage)
+ObjectHandle BlockPool::Add(BlockID id, PlayerTeam team, const sf::Vector2f& position)
 {
-	id = shootMessage.id;
-	shotBy = shootMessage.shotBy;
-	team = shootMessage.team;
-	position = { shootMessage.x, shootMessage.y };
-	initPosition = position;
-	direction = { shootMessage.dirX, shootMessage.dirY };
-	serverShootTime = 0.0f;
-	clientShootTime = 0.0f;
+	ObjectHandle handle = m_HandleTable.Allocate(Size());
+	m_Handles.push_back(handle);
+
+	m_IDs.push_back(id);
+	m_Teams.push_back(team);
+	m_PositionX.push_back(position.x);
+	m_PositionY.push_back(position.y);
+
+	return handle;
 }
 
-void ProjectileState::SimulationStep(float dt)
+void BlockPool::Remove(size_t index)
 {
-	position += direction * PROJECTILE_MOVE_SPEED * dt;
+	m_HandleTable.Free(m_Handles[index]);
+
+	// the last block is moving into this index
+	if (index != Size() - 1)
+		m_HandleTable.Move(m_Handles.back(), index);
+
+	SwapAndPop(m_Handles, index);
+	SwapAndPop(m_IDs, index);
+	SwapAndPop(m_Teams, index);
+	SwapAndPop(m_PositionX, index);
+	SwapAndPop(m_PositionY, index);
 }
 
-sf::Vector2f ProjectileState::PositionAtServerTime(float t)
+void BlockPool::Clear()
 {
-	float dt = t - serverShootTime;
-	return initPosition + direction * (PROJECTILE_MOVE_SPEED * dt);
+	m_HandleTable.Clear();
+	m_Handles.clear();
+	m_IDs.clear();
+	m_Teams.clear();
+	m_PositionX.clear();
+	m_PositionY.clear();
 }
 
-sf::Vector2f ProjectileState::PositionAtClientTime(float t)
+
+ProjectilePool::ProjectilePool(size_t capacity)
 {
-	float dt = t - clientShootTime;
-	return initPosition + direction * (PROJECTILE_MOVE_SPEED * dt);
+	m_HandleTable.Reserve(capacity);
+	m_Handles.reserve(capacity);
+	m_IDs.reserve(capacity);
+	m_Teams.reserve(capacity);
+	m_PositionX.reserve(capacity);
+	m_PositionY.reserve(capacity);
+	m_PreviousX.reserve(capacity);
+	m_PreviousY.reserve(capacity);
+	m_DirectionX.reserve(capacity);
+	m_DirectionY.reserve(capacity);
+	m_ServerShootTime.reserve(capacity);
+	m_ClientShootTime.reserve(capacity);
 }
 
+ObjectHandle ProjectilePool::Add(const ShootMessage& shootMessage, float serverShootTime, float clientShootTime)
+{
+	ObjectHandle handle = m_HandleTable.Allocate(Size());
+	m_Handles.push_back(handle);
+
+	m_IDs.push_back(shootMessage.id);
+	m_Teams.push_back(shootMessage.team);
+
+	m_PositionX.push_back(shootMessage.x);
+	m_PositionY.push_back(shootMessage.y);
+	m_PreviousX.push_back(shootMessage.x);
+	m_PreviousY.push_back(shootMessage.y);
 
-bool ProjectileState::BlockCollision(BlockState* block)
+	m_DirectionX.push_back(shootMessage.dirX);
+	m_DirectionY.push_back(shootMessage.dirY);
+
+	m_ServerShootTime.push_back(serverShootTime);
+	m_ClientShootTime.push_back(clientShootTime);
+
+	return handle;
+}
+
+void ProjectilePool::Remove(size_t index)
 {
-	const float r1 = 0.5f * BLOCK_SIZE; // block inner circle radius
-	const float r2 = sqrtf(0.5f * BLOCK_SIZE * BLOCK_SIZE); // block outer circle radius
-	float sqrDistanceBetweenCentres = SqrLength(block->position - position);
+	m_HandleTable.Free(m_Handles[index]);
+
+	// the last projectile is moving into this index
+	if (index != Size() - 1)
+		m_HandleTable.Move(m_Handles.back(), index);
+
+	SwapAndPop(m_Handles, index);
+	SwapAndPop(m_IDs, index);
+	SwapAndPop(m_Teams, index);
+	SwapAndPop(m_PositionX, index);
+	SwapAndPop(m_PositionY, index);
+	SwapAndPop(m_PreviousX, index);
+	SwapAndPop(m_PreviousY, index);
+	SwapAndPop(m_DirectionX, index);
+	SwapAndPop(m_DirectionY, index);
+	SwapAndPop(m_ServerShootTime, index);
+	SwapAndPop(m_ClientShootTime, index);
+}
 
-	if (sqrDistanceBetweenCentres > (r2 + PROJECTILE_RADIUS) * (r2 + PROJECTILE_RADIUS)) return false;
-	if (sqrDistanceBetweenCentres < (r1 + PROJECTILE_RADIUS) * (r1 + PROJECTILE_RADIUS)) return true;
+void ProjectilePool::Clear()
+{
+	m_HandleTable.Clear();
+	m_Handles.clear();
+	m_IDs.clear();
+	m_Teams.clear();
+	m_PositionX.clear();
+	m_PositionY.clear();
+	m_PreviousX.clear();
+	m_PreviousY.clear();
+	m_DirectionX.clear();
+	m_DirectionY.clear();
+	m_ServerShootTime.clear();
+	m_ClientShootTime.clear();
+}
 
-	sf::Vector2f c1ToC2 = Normalized(block->position - position);
-	sf::Vector2f p = position + PROJECTILE_RADIUS * c1ToC2;
+void ProjectilePool::SimulationStep(float dt)
+{
+	// every projectile moves at the same speed
+	IntegrateProjectiles(m_PositionX.data(), m_PositionY.data(), m_PreviousX.data(), m_PreviousY.data(), m_DirectionX.data(), m_DirectionY.data(),
+						 Size(), PROJECTILE_MOVE_SPEED * dt);
+}
 
-	if (p.x < block->position.x - 0.5f * BLOCK_SIZE || p.x > block->position.x + 0.5f * BLOCK_SIZE) return false;
-	if (p.y < block->position.y - 0.5f * BLOCK_SIZE || p.y > block->position.y + 0.5f * BLOCK_SIZE) return false;
+void ProjectilePool::FindPlayerOverlaps(const PlayerBoundsBatch& players, std::vector<PlayerMask>& masks) const
+{
+	masks.resize(Size());
+	if (masks.empty()) return;
 
-	return true;
+	// the projectiles are all the same size, as are the players
+	OverlapProjectilesWithPlayers(m_PreviousX.data(), m_PreviousY.data(), m_PositionX.data(), m_PositionY.data(), Size(),
+								  PROJECTILE_RADIUS + 0.5f * PLAYER_SIZE, players, masks.data());
 }
 
 
-bool ProjectileState::PlayerCollision(const sf::Vector2f& playerPos)
+bool ProjectilePool::BlockCollision(size_t index, const sf::Vector2f& blockPos, float& hitTime) const
 {
-	float sqrDistanceBetweenCentres = SqrLength(playerPos - position);
-	float playerRadius = 0.5f * PLAYER_SIZE;
-	return sqrDistanceBetweenCentres < (PROJECTILE_RADIUS + playerRadius)* (PROJECTILE_RADIUS + playerRadius);
+	const sf::Vector2f blockHalfSize{ 0.5f * BLOCK_SIZE, 0.5f * BLOCK_SIZE };
+	return SweptCircleAABB(GetPreviousPosition(index), GetPosition(index), PROJECTILE_RADIUS, blockPos, blockHalfSize, hitTime);
 }
 
-bool ProjectileState::PlayerCollision(const sf::Vector2f& playerPos, float timeDelta)
+
+bool ProjectilePool::PlayerCollision(size_t index, const sf::Vector2f& playerPos, float& hitTime) const
 {
-	// work out position timeDelta seconds in the past
-	sf::Vector2f p = position - (timeDelta * PROJECTILE_MOVE_SPEED * direction);
-	float sqrDistanceBetweenCentres = SqrLength(playerPos - p);
-	float playerRadius = 0.5f * PLAYER_SIZE;
-	return sqrDistanceBetweenCentres < (PROJECTILE_RADIUS + playerRadius)* (PROJECTILE_RADIUS + playerRadius);
+	return SweptCircleCircle(GetPreviousPosition(index), GetPosition(index), PROJECTILE_RADIUS, playerPos, 0.5f * PLAYER_SIZE, hitTime);
 }
@@ -1,49 +1,115 @@
 #pragma once
 
 #include "Network/NetworkTypes.h"
+#include "HandleTable.h"
+#include "ProjectileKernels.h"
 #include <SFML/System.hpp>
 
+#include <vector>
+#include <algorithm>
+
 // Descriptions of the game objects for the server
 // there is purely data, no concept of graphics
 
+// objects are stored in pools as a structure of arrays
+// each property has its own contiguous array, and the object at index i has its properties at index i of every array
+// so loops over every object walk straight through memory, and only touch the properties they need
+// objects are removed by moving the last object into the gap, so indices change; handles are used to refer to an object over time
+
 
 // block state is constant
-struct BlockState
+class BlockPool
 {
-	BlockID id;
-	PlayerTeam team;
+public:
+	BlockPool(size_t capacity);
+	~BlockPool() = default;
+
+	ObjectHandle Add(BlockID id, PlayerTeam team, const sf::Vector2f& position);
+	// remove the block at index, the last block takes its place
+	void Remove(size_t index);
+	void Clear();
+
+	inline size_t Size() const { return m_IDs.size(); }
+	inline bool Empty() const { return m_IDs.empty(); }
 
-	sf::Vector2f position;
+	// convert between handles and indices
+	// IndexOf returns HandleTable::INVALID_INDEX if the block has been removed
+	inline size_t IndexOf(ObjectHandle handle) const { return m_HandleTable.Lookup(handle); }
+	inline ObjectHandle HandleAt(size_t index) const { return m_Handles[index]; }
 
-	BlockState(PlaceMessage placeMessage);
-	BlockState(BlockID _id, PlayerTeam _team, const sf::Vector2f& _position);
+	inline BlockID GetID(size_t index) const { return m_IDs[index]; }
+	inline PlayerTeam GetTeam(size_t index) const { return m_Teams[index]; }
+	inline sf::Vector2f GetPosition(size_t index) const { return { m_PositionX[index], m_PositionY[index] }; }
+
+private:
+	HandleTable m_HandleTable;
+	std::vector<ObjectHandle> m_Handles;
+
+	std::vector<BlockID> m_IDs;
+	std::vector<PlayerTeam> m_Teams;
+	std::vector<float> m_PositionX;
+	std::vector<float> m_PositionY;
 };
 
-struct ProjectileState
+
+class ProjectilePool
 {
-	ProjectileID id;
-	ClientID shotBy;
-	PlayerTeam team;
+public:
+	ProjectilePool(size_t capacity);
+	~ProjectilePool() = default;
 
-	sf::Vector2f position;
+	// serverShootTime is when the server recieved the request to shoot a projectile, and when the projectile was actually created
+	// clientShootTime is the sim time when the projectile was shot (local to the client that shot it)
+	ObjectHandle Add(const ShootMessage& shootMessage, float serverShootTime, float clientShootTime);
+	// remove the projectile at index, the last projectile takes its place
+	void Remove(size_t index);
+	void Clear();
 
-	sf::Vector2f initPosition;
-	sf::Vector2f direction;
+	inline size_t Size() const { return m_IDs.size(); }
+	inline bool Empty() const { return m_IDs.empty(); }
 
-	float serverShootTime; // the sim time when the projectile was shot (local to the client that shot it)
-	float clientShootTime; // when the server recieved the request to shoot a projectile, and when the projectile was actually created
+	// convert between handles and indices
+	// IndexOf returns HandleTable::INVALID_INDEX if the projectile has been removed
+	inline size_t IndexOf(ObjectHandle handle) const { return m_HandleTable.Lookup(handle); }
+	inline ObjectHandle HandleAt(size_t index) const { return m_Handles[index]; }
 
-	ProjectileState(ShootMessage shootMessage);
+	inline ProjectileID GetID(size_t index) const { return m_IDs[index]; }
+	inline PlayerTeam GetTeam(size_t index) const { return m_Teams[index]; }
+	inline sf::Vector2f GetPosition(size_t index) const { return { m_PositionX[index], m_PositionY[index] }; }
+	// position before the last simulation step
+	inline sf::Vector2f GetPreviousPosition(size_t index) const { return { m_PreviousX[index], m_PreviousY[index] }; }
 
-	void SimulationStep(float dt);
+	// how far behind the server the shooter's view of the world is
+	// hits are checked against where the shooter saw the other players, not where the server has them now
+	inline float RewindTime(size_t index) const { return std::min(m_ServerShootTime[index] - m_ClientShootTime[index], MAX_LAG_COMPENSATION); }
 
-	// from knowing the initial position, the time of shoot, and direction of the projectile, its position at any time in the past can be calculated
-	sf::Vector2f PositionAtServerTime(float t);
-	sf::Vector2f PositionAtClientTime(float t);
+	// move every projectile along its path
+	void SimulationStep(float dt);
+	// find which players each projectile may have hit during the last simulation step
+	// masks is resized to one entry per projectile
+	void FindPlayerOverlaps(const PlayerBoundsBatch& players, std::vector<PlayerMask>& masks) const;
 
 	// collision detection
-	bool BlockCollision(BlockState* block);
-	bool PlayerCollision(const sf::Vector2f& playerPos);
-	// check for player timeDelta seconds in the past
-	bool PlayerCollision(const sf::Vector2f& playerPos, float timeDelta);
+	// these sweep the projectile along its path over the last simulation step, so fast projectiles can't pass through anything
+	// hitTime is set to how far along the step the hit occurred, in the range [0, 1]
+	bool BlockCollision(size_t index, const sf::Vector2f& blockPos, float& hitTime) const;
+	bool PlayerCollision(size_t index, const sf::Vector2f& playerPos, float& hitTime) const;
+
+private:
+	HandleTable m_HandleTable;
+	std::vector<ObjectHandle> m_Handles;
+
+	std::vector<ProjectileID> m_IDs;
+	std::vector<PlayerTeam> m_Teams;
+
+	std::vector<float> m_PositionX;
+	std::vector<float> m_PositionY;
+	std::vector<float> m_PreviousX;
+	std::vector<float> m_PreviousY;
+
+	std::vector<float> m_DirectionX;
+	std::vector<float> m_DirectionY;
+
+	std::vector<float> m_ServerShootTime;
+	std::vector<float> m_ClientShootTime;
 };
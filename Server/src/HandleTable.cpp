@@ -0,0 +1,68 @@
+#include "HandleTable.h"
+
+#include <cassert>
+
+
+void HandleTable::Reserve(size_t capacity)
+{
+	m_Slots.reserve(capacity);
+	m_FreeSlots.reserve(capacity);
+}
+
+ObjectHandle HandleTable::Allocate(size_t index)
+{
+	sf::Uint32 slot;
+	if (!m_FreeSlots.empty())
+	{
+		slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else
+	{
+		// slot 0xFFFF is never used so that no handle can equal INVALID_OBJECT_HANDLE
+		assert(m_Slots.size() < 0xFFFF && "Handle table is full!");
+		slot = static_cast<sf::Uint32>(m_Slots.size());
+		m_Slots.emplace_back();
+	}
+
+	m_Slots[slot].index = index;
+	return (static_cast<ObjectHandle>(m_Slots[slot].generation) << 16) | slot;
+}
+
+void HandleTable::Free(ObjectHandle handle)
+{
+	if (Lookup(handle) == INVALID_INDEX) return;
+
+	Slot& slot = m_Slots[SlotOf(handle)];
+	slot.index = INVALID_INDEX;
+	slot.generation++;
+	m_FreeSlots.push_back(static_cast<sf::Uint16>(SlotOf(handle)));
+}
+
+void HandleTable::Move(ObjectHandle handle, size_t index)
+{
+	assert(Lookup(handle) != INVALID_INDEX && "Moving an invalid handle!");
+	m_Slots[SlotOf(handle)].index = index;
+}
+
+void HandleTable::Clear()
+{
+	// free every slot that is in use, bumping its generation so that existing handles are invalidated
+	for (size_t i = 0; i < m_Slots.size(); i++)
+	{
+		Slot& slot = m_Slots[i];
+		if (slot.index == INVALID_INDEX) continue;
+
+		slot.index = INVALID_INDEX;
+		slot.generation++;
+		m_FreeSlots.push_back(static_cast<sf::Uint16>(i));
+	}
+}
+
+size_t HandleTable::Lookup(ObjectHandle handle) const
+{
+	sf::Uint32 slot = SlotOf(handle);
+	if (slot >= m_Slots.size()) return INVALID_INDEX;
+	if (m_Slots[slot].generation != GenerationOf(handle)) return INVALID_INDEX;
+	return m_Slots[slot].index;
+}
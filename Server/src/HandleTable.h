@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <vector>
+
+
+// a handle refers to an object in a pool, and stays valid while the pool moves the object around
+// the low 16 bits are a slot in the pool's handle table, the high 16 bits are the generation of that slot
+using ObjectHandle = sf::Uint32;
+const ObjectHandle INVALID_OBJECT_HANDLE = 0xFFFFFFFF;
+
+
+// maps handles to indices in a densely packed array
+// the dense array can be reordered (e.g. swap-and-pop removal) as long as the table is told where each object moved to
+// each slot's generation is bumped when it is freed, so a handle to a removed object never resolves to whatever reuses its slot
+class HandleTable
+{
+public:
+	static constexpr size_t INVALID_INDEX = static_cast<size_t>(-1);
+
+	HandleTable() = default;
+	~HandleTable() = default;
+
+	// set aside enough slots for capacity objects so that allocating doesn't reallocate
+	void Reserve(size_t capacity);
+
+	// create a handle for an object stored at index
+	ObjectHandle Allocate(size_t index);
+	// invalidate a handle, its slot can then be reused
+	void Free(ObjectHandle handle);
+	// the object a handle refers to has moved to a new index
+	void Move(ObjectHandle handle, size_t index);
+	// invalidate every handle
+	void Clear();
+
+	// get the index of the object a handle refers to, or INVALID_INDEX if the handle is no longer valid
+	size_t Lookup(ObjectHandle handle) const;
+
+private:
+	static inline sf::Uint32 SlotOf(ObjectHandle handle) { return handle & 0xFFFF; }
+	static inline sf::Uint16 GenerationOf(ObjectHandle handle) { return static_cast<sf::Uint16>(handle >> 16); }
+
+	struct Slot
+	{
+		size_t index = INVALID_INDEX;	// where the object is in the dense array, INVALID_INDEX if the slot is free
+		sf::Uint16 generation = 0;
+	};
+
+	std::vector<Slot> m_Slots;
+	std::vector<sf::Uint16> m_FreeSlots;
+};
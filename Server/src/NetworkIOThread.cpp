@@ -0,0 +1,230 @@
+#include "NetworkIOThread.h"
+
+#include "Log.h"
+#include "Trace.h"
+
+
+namespace
+{
+	// the thread is woken whenever there is work, this is only a backstop in case the wake up socket couldn't be bound
+	const float MAX_WAIT = 1.0f;
+}
+
+
+NetworkIOThread::NetworkIOThread(sf::UdpSocket& socket, const sf::Clock& clock)
+	: m_Socket(socket), m_Clock(clock), m_Inbound(NETWORK_QUEUE_SIZE), m_ReceiveBuffer(sf::UdpSocket::MaxDatagramSize)
+{
+	m_Outbound.reserve(MAX_NUM_ROOMS);
+	for (unsigned int i = 0; i < MAX_NUM_ROOMS; i++)
+		m_Outbound.push_back(new SpscRing<OutgoingDatagram>(NETWORK_QUEUE_SIZE));
+}
+
+NetworkIOThread::~NetworkIOThread()
+{
+	Stop();
+
+	for (auto queue : m_Outbound)
+		delete queue;
+}
+
+void NetworkIOThread::Start()
+{
+	if (m_Running) return;
+
+	// the port is picked by the os, nothing outside this machine can reach it
+	m_CanWake = m_WakeSocket.bind(sf::Socket::AnyPort, sf::IpAddress::LocalHost) == sf::Socket::Done;
+	if (m_CanWake)
+	{
+		m_WakeSocket.setBlocking(false);
+		m_Selector.add(m_WakeSocket);
+	}
+	else
+	{
+		LOG_ERROR("Failed to bind the network thread's wake up socket, queued datagrams may be held up");
+	}
+
+	m_Selector.add(m_Socket);
+	m_Running = true;
+	m_Thread = std::thread(&NetworkIOThread::ThreadMain, this);
+}
+
+void NetworkIOThread::Stop()
+{
+	if (!m_Running) return;
+
+	m_Running = false;
+	Wake();
+	m_Thread.join();
+	m_Selector.clear();
+	m_WakeSocket.unbind();
+	m_CanWake = false;
+	m_WakePending = false;
+}
+
+bool NetworkIOThread::SendUdp(unsigned int roomID, const PacketWriter& packet, const sf::IpAddress& address, unsigned short port, ClientID clientID)
+{
+	OutgoingDatagram* datagram = m_Outbound[roomID]->BeginPush();
+	if (!datagram)
+	{
+		m_OutboundDrops++;
+		return false;
+	}
+
+	// the slot's buffer is reused, so this only allocates the first few times round the queue
+	const char* data = packet.GetData();
+	datagram->data.assign(data, data + packet.GetDataSize());
+	datagram->address = address;
+	datagram->port = port;
+	datagram->clientID = clientID;
+
+	m_Outbound[roomID]->CommitPush();
+
+	// no need to wake the thread if a wake up is already on its way
+	if (!m_WakePending.exchange(true))
+		Wake();
+	return true;
+}
+
+NetworkIOStats NetworkIOThread::TakeStats()
+{
+	NetworkIOStats stats;
+	stats.received = m_Received.exchange(0);
+	stats.malformed = m_Malformed.exchange(0);
+	stats.inboundDrops = m_InboundDrops.exchange(0);
+	stats.receiveErrors = m_ReceiveErrors.exchange(0);
+	stats.sent = m_Sent.exchange(0);
+	stats.outboundDrops = m_OutboundDrops.exchange(0);
+	stats.sendErrors = m_SendErrors.exchange(0);
+	return stats;
+}
+
+void NetworkIOThread::ThreadMain()
+{
+	TRACE_THREAD_NAME("Network");
+
+	while (m_Running)
+	{
+		// sleep until a datagram arrives or one is queued to be sent
+		if (m_Selector.wait(sf::seconds(MAX_WAIT)))
+		{
+			if (m_Selector.isReady(m_WakeSocket))
+				DrainWakeSocket();
+			if (m_Selector.isReady(m_Socket))
+				ReceiveDatagrams();
+		}
+
+		SendDatagrams();
+	}
+
+	// don't leave anything that was queued before stopping unsent
+	SendDatagrams();
+}
+
+void NetworkIOThread::Wake()
+{
+	if (!m_CanWake) return;
+
+	// the contents don't matter
+	const char wake = 0;
+	m_WakeSocket.send(&wake, 1, sf::IpAddress::LocalHost, m_WakeSocket.getLocalPort());
+}
+
+void NetworkIOThread::DrainWakeSocket()
+{
+	sf::IpAddress address;
+	unsigned short port;
+	size_t received;
+	while (m_WakeSocket.receive(m_WakeBuffer, sizeof(m_WakeBuffer), received, address, port) == sf::Socket::Done);
+
+	// cleared before the queues are read, so anything queued from here on sends another wake up
+	// exchanging, rather than storing, makes the datagrams queued before the last wake up visible
+	m_WakePending.exchange(false);
+}
+
+void NetworkIOThread::ReceiveDatagrams()
+{
+	TRACE_SCOPE("NetworkIOThread::ReceiveDatagrams");
+
+	// drain the socket into the queue
+	// failures are only counted, logging every one would flood the log under exactly the load this thread is for
+	sf::IpAddress address;
+	unsigned short port;
+	size_t size;
+	while (true)
+	{
+		auto status = m_Socket.receive(m_ReceiveBuffer.data(), m_ReceiveBuffer.size(), size, address, port);
+		if (status == sf::Socket::Error)
+		{
+			// a failed receive still consumes whatever caused it, so keep draining
+			m_ReceiveErrors++;
+			continue;
+		}
+		if (status != sf::Socket::Done)
+		{
+			// nothing left to receive
+			break;
+		}
+		float receiveTime = m_Clock.getElapsedTime().asSeconds();
+
+		// the socket still has to be drained even when the main thread hasn't kept up, or it would stay readable
+		UdpMessage* message = m_Inbound.BeginPush();
+		if (!message)
+		{
+			m_InboundDrops++;
+			continue;
+		}
+
+		// an uncommitted slot is simply reused for the next datagram
+		if (!DecodeDatagram(size, *message))
+		{
+			m_Malformed++;
+			continue;
+		}
+
+		message->size = size;
+		message->address = address;
+		message->port = port;
+		message->receiveTime = receiveTime;
+		m_Inbound.CommitPush();
+		m_Received++;
+	}
+}
+
+bool NetworkIOThread::DecodeDatagram(size_t size, UdpMessage& message) const
+{
+	PacketReader packet{ m_ReceiveBuffer.data(), size };
+	packet >> message.header;
+	if (!packet) return false;
+
+	switch (message.header.messageCode)
+	{
+	case MessageCode::Update:	packet >> message.update; break;
+	case MessageCode::Ping:		packet >> message.ping; break;
+	default:					return false;
+	}
+	return static_cast<bool>(packet);
+}
+
+void NetworkIOThread::SendDatagrams()
+{
+	for (auto queue : m_Outbound)
+	{
+		size_t count = queue->Available();
+		if (count == 0) continue;
+
+		// every wake up checks all the queues, so only the ones with something in them are traced
+		TRACE_SCOPE("NetworkIOThread::SendDatagrams", TraceArg{ "datagrams", static_cast<sf::Int64>(count) });
+
+		for (size_t i = 0; i < count; i++)
+		{
+			OutgoingDatagram& datagram = queue->Peek(i);
+			// failures are counted and reported with the rest of the stats rather than logged one by one
+			auto status = m_Socket.send(datagram.data.data(), datagram.data.size(), datagram.address, datagram.port);
+			if (status == sf::Socket::Done)
+				m_Sent++;
+			else
+				m_SendErrors++;
+		}
+		queue->Pop(count);
+	}
+}
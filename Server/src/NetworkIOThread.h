@@ -0,0 +1,100 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "Network/NetworkTypes.h"
+#include "SpscRing.h"
+#include "Room.h"
+
+
+// a datagram that is waiting for the network thread to send it
+struct OutgoingDatagram
+{
+	std::vector<char> data;
+	sf::IpAddress address;
+	unsigned short port = 0;
+	ClientID clientID = INVALID_CLIENT_ID;
+};
+
+// counters kept by the network thread since they were last taken
+struct NetworkIOStats
+{
+	unsigned int received = 0;		// datagrams read from the socket and decoded
+	unsigned int malformed = 0;		// datagrams that couldn't be decoded, or that aren't meant to be sent via udp
+	unsigned int inboundDrops = 0;	// datagrams thrown away because the main thread had fallen behind
+	unsigned int receiveErrors = 0;	// failed reads from the socket
+	unsigned int sent = 0;			// datagrams written to the socket
+	unsigned int outboundDrops = 0;	// datagrams thrown away because the network thread had fallen behind
+	unsigned int sendErrors = 0;	// datagrams the socket failed to send
+};
+
+
+// reads and writes the udp socket on its own thread, so that bursts of traffic don't hold up the simulation
+// received datagrams are decoded and passed to the main thread through a lock-free queue,
+// and every room has its own queue of datagrams to send, so that each queue only ever has one producer
+// the thread sleeps until there is something to read, queuing a datagram to send wakes it up through a loopback socket
+class NetworkIOThread
+{
+public:
+	// the socket must not be used by anything else while the thread is running
+	// receive times are measured with the clock given
+	NetworkIOThread(sf::UdpSocket& socket, const sf::Clock& clock);
+	~NetworkIOThread();
+
+	void Start();
+	void Stop();
+
+	// main thread: messages that have been received, in the order they arrived
+	inline SpscRing<UdpMessage>& GetInbound() { return m_Inbound; }
+
+	// queue a datagram to be sent
+	// only one thread can send on a room's queue at a time, returns false if the queue is full
+	bool SendUdp(unsigned int roomID, const PacketWriter& packet, const sf::IpAddress& address, unsigned short port, ClientID clientID);
+	// the current time on the clock that receive times are measured with, can be read from any thread
+	inline float GetTime() const { return m_Clock.getElapsedTime().asSeconds(); }
+
+	// read and reset the counters
+	NetworkIOStats TakeStats();
+
+private:
+	void ThreadMain();
+	void ReceiveDatagrams();
+	// returns false if the datagram isn't a well formed update or ping
+	bool DecodeDatagram(size_t size, UdpMessage& message) const;
+	void SendDatagrams();
+	// get the thread out of its wait, callable from any thread
+	void Wake();
+	void DrainWakeSocket();
+
+private:
+	sf::UdpSocket& m_Socket;
+	sf::SocketSelector m_Selector;
+	const sf::Clock& m_Clock;
+
+	// bound to the loopback address, anything sent to it only serves to wake the thread
+	// the first datagram queued after the thread has woken sends one wake up, the rest of the burst rides on it
+	sf::UdpSocket m_WakeSocket;
+	bool m_CanWake = false; // only changed while the thread isn't running
+	std::atomic<bool> m_WakePending{ false };
+	char m_WakeBuffer[16]; // wake ups are read into here and thrown away
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Running{ false };
+
+	SpscRing<UdpMessage> m_Inbound;
+	// every datagram is read into here before it is decoded
+	std::vector<char> m_ReceiveBuffer;
+	// indexed by room id
+	std::vector<SpscRing<OutgoingDatagram>*> m_Outbound;
+
+	std::atomic<unsigned int> m_Received{ 0 };
+	std::atomic<unsigned int> m_Malformed{ 0 };
+	std::atomic<unsigned int> m_InboundDrops{ 0 };
+	std::atomic<unsigned int> m_ReceiveErrors{ 0 };
+	std::atomic<unsigned int> m_Sent{ 0 };
+	std::atomic<unsigned int> m_OutboundDrops{ 0 };
+	std::atomic<unsigned int> m_SendErrors{ 0 };
+};
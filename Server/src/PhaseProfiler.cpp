@@ -0,0 +1,209 @@
+#include "PhaseProfiler.h"
+
+#include "Constants.h"
+#include "Log.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+
+const sf::Int64 LatencyHistogram::MAX_VALUE;
+
+void LatencyHistogram::Record(sf::Int64 microseconds)
+{
+	sf::Int64 value = std::min(std::max(microseconds, sf::Int64(0)), MAX_VALUE);
+
+	m_Buckets[BucketIndex(value)]++;
+	m_Count++;
+	m_Total += value;
+	m_Min = std::min(m_Min, value);
+	m_Max = std::max(m_Max, value);
+}
+
+void LatencyHistogram::Add(const LatencyHistogram& other)
+{
+	for (int i = 0; i < NUM_BUCKETS; i++)
+		m_Buckets[i] += other.m_Buckets[i];
+
+	m_Count += other.m_Count;
+	m_Total += other.m_Total;
+	m_Min = std::min(m_Min, other.m_Min);
+	m_Max = std::max(m_Max, other.m_Max);
+}
+
+void LatencyHistogram::Reset()
+{
+	*this = LatencyHistogram{};
+}
+
+sf::Int64 LatencyHistogram::Percentile(float fraction) const
+{
+	if (m_Count == 0) return 0;
+
+	// the rank of the value we're after, counting from 1
+	unsigned int rank = static_cast<unsigned int>(std::ceil(fraction * m_Count));
+	rank = std::min(std::max(rank, 1u), m_Count);
+
+	unsigned int seen = 0;
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		seen += m_Buckets[i];
+		if (seen >= rank)
+		{
+			// every value in the bucket is reported as its largest, but never more than was actually recorded
+			return std::min(BucketUpperBound(i), m_Max);
+		}
+	}
+
+	return m_Max;
+}
+
+int LatencyHistogram::BucketIndex(sf::Int64 value)
+{
+	// small values are exact
+	if (value < SUB_BUCKET_COUNT) return static_cast<int>(value);
+
+	// find the power of two the value is in, then which of its sub buckets
+	int highestBit = 0;
+	while ((value >> (highestBit + 1)) != 0)
+		highestBit++;
+
+	// shifting leaves a value in [SUB_BUCKET_HALF, SUB_BUCKET_COUNT)
+	int shift = highestBit - (SUB_BUCKET_BITS - 1);
+	int subBucket = static_cast<int>(value >> shift);
+
+	return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + (subBucket - SUB_BUCKET_HALF);
+}
+
+sf::Int64 LatencyHistogram::BucketUpperBound(int index)
+{
+	if (index < SUB_BUCKET_COUNT) return index;
+
+	int shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF + 1;
+	sf::Int64 subBucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+
+	return ((subBucket + 1) << shift) - 1;
+}
+
+
+const char* ServerPhaseToStr(ServerPhase phase)
+{
+	switch (phase)
+	{
+	case ServerPhase::Tick:				return "Tick";
+	case ServerPhase::Accept:			return "Accept";
+	case ServerPhase::UdpRoute:			return "UdpRoute";
+	case ServerPhase::Rooms:			return "Rooms";
+	case ServerPhase::Cleanup:			return "Cleanup";
+	case ServerPhase::RoomUpdate:		return "RoomUpdate";
+	case ServerPhase::SimulateObjects:	return "SimulateObjects";
+	case ServerPhase::UpdateGameState:	return "UpdateGameState";
+	case ServerPhase::UdpDispatch:		return "UdpDispatch";
+	case ServerPhase::TcpReceive:		return "TcpReceive";
+	case ServerPhase::Snapshot:			return "Snapshot";
+	case ServerPhase::Ping:				return "Ping";
+	case ServerPhase::WorldStream:		return "WorldStream";
+	case ServerPhase::TcpFlush:			return "TcpFlush";
+	default:							return "Unknown";
+	}
+}
+
+
+void PhaseProfiler::End(ServerPhase phase, sf::Int64 begin)
+{
+	sf::Int64 duration = m_Clock.getElapsedTime().asMicroseconds() - begin;
+	Record(phase, duration);
+
+	TRACE_COMPLETE(ServerPhaseToStr(phase), duration);
+}
+
+void PhaseProfiler::Record(ServerPhase phase, sf::Int64 microseconds)
+{
+	m_Histograms[static_cast<size_t>(phase)].Record(microseconds);
+
+	if (phase == ServerPhase::Tick && microseconds > static_cast<sf::Int64>(UPDATE_FREQUENCY * 1000000.0f))
+		m_OverBudgetTicks++;
+}
+
+void PhaseProfiler::Add(const PhaseProfiler& other)
+{
+	for (size_t i = 0; i < static_cast<size_t>(ServerPhase::Count); i++)
+		m_Histograms[i].Add(other.m_Histograms[i]);
+
+	m_OverBudgetTicks += other.m_OverBudgetTicks;
+}
+
+void PhaseProfiler::Reset()
+{
+	for (auto& histogram : m_Histograms)
+		histogram.Reset();
+
+	m_OverBudgetTicks = 0;
+}
+
+void PhaseProfiler::LogSummary() const
+{
+	for (size_t i = 0; i < static_cast<size_t>(ServerPhase::Count); i++)
+	{
+		const LatencyHistogram& histogram = m_Histograms[i];
+		if (histogram.Count() == 0) continue;
+
+		LOG_INFO("[Profile] {0:<16} n: {1:>7}  mean: {2:8.3f}ms  p50: {3:8.3f}ms  p99: {4:8.3f}ms  max: {5:8.3f}ms",
+			ServerPhaseToStr(static_cast<ServerPhase>(i)), histogram.Count(), 0.001 * histogram.Mean(),
+			0.001 * histogram.Percentile(0.5f), 0.001 * histogram.Percentile(0.99f), 0.001 * histogram.Max());
+	}
+
+	if (m_OverBudgetTicks > 0)
+		LOG_WARN("[Profile] {0} ticks took longer than the {1:.0f}ms update budget", m_OverBudgetTicks, 1000.0f * UPDATE_FREQUENCY);
+}
+
+bool PhaseProfiler::WriteJson(const std::string& filename, float interval, const std::string& extra) const
+{
+	// write to a temporary file and move it into place, so that a reader never sees half a file
+	std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream file(tempFilename, std::ios::trunc);
+		if (!file) return false;
+
+		file.setf(std::ios::fixed);
+		file.precision(3);
+
+		file << "{\n";
+		file << "\t\"interval\": " << interval << ",\n";
+		file << "\t\"budget_ms\": " << 1000.0f * UPDATE_FREQUENCY << ",\n";
+		file << "\t\"over_budget_ticks\": " << m_OverBudgetTicks << ",\n";
+		if (!extra.empty())
+			file << extra << ",\n";
+
+		file << "\t\"phases\": {";
+		bool first = true;
+		for (size_t i = 0; i < static_cast<size_t>(ServerPhase::Count); i++)
+		{
+			const LatencyHistogram& histogram = m_Histograms[i];
+
+			file << (first ? "\n" : ",\n");
+			first = false;
+
+			file << "\t\t\"" << ServerPhaseToStr(static_cast<ServerPhase>(i)) << "\": { "
+				<< "\"count\": " << histogram.Count()
+				<< ", \"min_ms\": " << 0.001 * histogram.Min()
+				<< ", \"mean_ms\": " << 0.001 * histogram.Mean()
+				<< ", \"p50_ms\": " << 0.001 * histogram.Percentile(0.5f)
+				<< ", \"p90_ms\": " << 0.001 * histogram.Percentile(0.9f)
+				<< ", \"p99_ms\": " << 0.001 * histogram.Percentile(0.99f)
+				<< ", \"max_ms\": " << 0.001 * histogram.Max()
+				<< " }";
+		}
+		file << "\n\t}\n";
+		file << "}\n";
+
+		if (!file) return false;
+	}
+
+	// rename won't replace an existing file on every platform
+	std::remove(filename.c_str());
+	return std::rename(tempFilename.c_str(), filename.c_str()) == 0;
+}
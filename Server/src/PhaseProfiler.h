@@ -0,0 +1,125 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <cstddef>
+#include <string>
+
+
+// a histogram of durations that keeps a fixed relative precision across a wide range, in the style of HdrHistogram
+// durations are recorded in microseconds: below 32us every value has its own bucket,
+// above that every power of two is split into 16 buckets, so any percentile is within about 6% of the true value
+// recording is constant time and never allocates
+class LatencyHistogram
+{
+public:
+	// values above this are counted in the last bucket (about a minute)
+	static const sf::Int64 MAX_VALUE = (sf::Int64(1) << 26) - 1;
+
+	void Record(sf::Int64 microseconds);
+	// combine with a histogram recorded somewhere else, e.g. on another thread
+	void Add(const LatencyHistogram& other);
+	void Reset();
+
+	inline unsigned int Count() const { return m_Count; }
+	inline sf::Int64 Min() const { return m_Count > 0 ? m_Min : 0; }
+	inline sf::Int64 Max() const { return m_Max; }
+	inline double Mean() const { return m_Count > 0 ? static_cast<double>(m_Total) / m_Count : 0.0; }
+	// the smallest recorded value that at least fraction (0-1) of the values are no greater than
+	sf::Int64 Percentile(float fraction) const;
+
+private:
+	static const int SUB_BUCKET_BITS = 5;
+	static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static const int SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+	// 32 buckets for the first two powers of two, then 16 for every one after that up to MAX_VALUE
+	static const int NUM_BUCKETS = SUB_BUCKET_COUNT + (26 - SUB_BUCKET_BITS) * SUB_BUCKET_HALF;
+
+	static int BucketIndex(sf::Int64 value);
+	// the largest value that falls into a bucket
+	static sf::Int64 BucketUpperBound(int index);
+
+private:
+	unsigned int m_Buckets[NUM_BUCKETS] = {};
+	unsigned int m_Count = 0;
+	sf::Int64 m_Total = 0;
+	sf::Int64 m_Min = MAX_VALUE;
+	sf::Int64 m_Max = 0;
+};
+
+
+// the parts of a server tick that are timed
+// the first few run on the main thread once per tick, the rest run inside each room
+enum class ServerPhase
+{
+	Tick,				// everything the main loop does in a tick, apart from sleeping
+	Accept,				// accepting new connections
+	UdpRoute,			// sorting the datagrams from the network thread into rooms
+	Rooms,				// updating every room in parallel, until the last one has finished
+	Cleanup,			// removing the clients that left
+
+	RoomUpdate,			// the whole of a single room's update
+	SimulateObjects,	// SimulateGameObjects, once per simulation step
+	UpdateGameState,	// UpdateGameState, once per simulation step
+	UdpDispatch,		// processing the updates and pings routed to the room
+	TcpReceive,			// receiving and processing tcp messages from every client
+	Snapshot,			// taking a snapshot and sending every client its update
+	Ping,				// pinging the clients that are due one
+	WorldStream,		// streaming the world to joining clients
+	TcpFlush,			// sending the tcp messages queued during the tick
+
+	Count
+};
+const char* ServerPhaseToStr(ServerPhase phase);
+
+
+// times the phases of the server's tick
+// a profiler must only be used from one thread at a time, so every room has its own and they are added together to report
+class PhaseProfiler
+{
+public:
+	// start of a phase, to pass to End
+	inline sf::Int64 Begin() const { return m_Clock.getElapsedTime().asMicroseconds(); }
+	// record the time since begin against a phase
+	// with tracing enabled the phase also shows up in the trace
+	void End(ServerPhase phase, sf::Int64 begin);
+	void Record(ServerPhase phase, sf::Int64 microseconds);
+
+	inline const LatencyHistogram& GetHistogram(ServerPhase phase) const { return m_Histograms[static_cast<size_t>(phase)]; }
+	// ticks that took longer than UPDATE_FREQUENCY
+	inline unsigned int GetOverBudgetTicks() const { return m_OverBudgetTicks; }
+
+	void Add(const PhaseProfiler& other);
+	void Reset();
+
+	// one line per phase that ran, through the log
+	void LogSummary() const;
+	// write every phase as json, for tools to read
+	// interval is the time the histograms cover (seconds), extra is inserted as-is into the top level object
+	// returns false if the file couldn't be written
+	bool WriteJson(const std::string& filename, float interval, const std::string& extra) const;
+
+private:
+	sf::Clock m_Clock;
+	LatencyHistogram m_Histograms[static_cast<size_t>(ServerPhase::Count)];
+	unsigned int m_OverBudgetTicks = 0;
+};
+
+
+// times the scope it is declared in
+class ProfileScope
+{
+public:
+	ProfileScope(PhaseProfiler& profiler, ServerPhase phase)
+		: m_Profiler(profiler), m_Phase(phase), m_Begin(profiler.Begin())
+	{
+	}
+	~ProfileScope() { m_Profiler.End(m_Phase, m_Begin); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	PhaseProfiler& m_Profiler;
+	ServerPhase m_Phase;
+	sf::Int64 m_Begin;
+};
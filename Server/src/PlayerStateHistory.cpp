@@ -0,0 +1,131 @@
+#include "PlayerStateHistory.h"
+
+#include "MathUtils.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+PlayerStateHistory::PlayerStateHistory()
+{
+	// enough room for twice the number of updates expected over the history duration
+	// rounded up to a power of two so that indices can wrap with a mask
+	size_t required = 2 * static_cast<size_t>(std::ceil(STATE_HISTORY_DURATION / UPDATE_FREQUENCY));
+	size_t capacity = 1;
+	while (capacity < required) capacity <<= 1;
+
+	m_Frames.resize(capacity);
+	m_Mask = capacity - 1;
+}
+
+void PlayerStateHistory::Insert(const PlayerStateFrame& frame)
+{
+	// find where the frame belongs, starting from the newest
+	size_t i = 0;
+	while (i < m_Count && (*this)[i].sendTimestamp > frame.sendTimestamp) i++;
+
+	// ignore duplicates
+	if (i < m_Count && (*this)[i].sendTimestamp == frame.sendTimestamp) return;
+
+	if (m_Count == m_Frames.size())
+	{
+		// the buffer is full; the oldest frame has to make room
+		// (if the new frame is older than everything else then it is the one that gets dropped)
+		if (i == m_Count) return;
+		PopOldest();
+	}
+
+	// grow at the newest end, and shift the frames newer than the new one up by one
+	m_Newest = (m_Newest + 1) & m_Mask;
+	m_Count++;
+	for (size_t j = 0; j < i; j++)
+		m_Frames[PhysicalIndex(j)] = m_Frames[PhysicalIndex(j + 1)];
+
+	m_Frames[PhysicalIndex(i)] = frame;
+	m_Duration += frame.dt;
+}
+
+void PlayerStateHistory::Trim(float maxDuration)
+{
+	// work out how much extra history is currently stored
+	float dt = m_Duration - maxDuration;
+
+	// remove all of the extra history
+	while (m_Count > 1 && dt > 0.0f)
+	{
+		PlayerStateFrame& oldest = Oldest();
+		if (dt >= oldest.dt)
+		{
+			// we can remove this entire frame
+			dt -= oldest.dt;
+			PopOldest();
+		}
+		else
+		{
+			// we have to cut this frame short
+			// assume the player travelled at a constant velocity during this frame
+			float t = dt / oldest.dt;
+
+			// interpolate between the second oldest and oldest to correctly trim the history
+			const PlayerStateFrame& secondOldest = (*this)[m_Count - 2];
+			oldest.position = Lerp(oldest.position, secondOldest.position, t);
+			oldest.rotation = LerpAngleDegrees(oldest.rotation, secondOldest.rotation, t);
+			oldest.dt -= dt;
+			m_Duration -= dt;
+			break;
+		}
+	}
+}
+
+sf::Vector2f PlayerStateHistory::PositionAtTime(float timestamp) const
+{
+	assert(m_Count > 0 && "State history is empty!");
+
+	// binary search for the newest frame at or before the timestamp
+	// frames are ordered newest first, so timestamps decrease with index
+	size_t low = 0, high = m_Count;
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if ((*this)[mid].sendTimestamp > timestamp)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	// clamp to the ends of the history
+	if (low == 0) return (*this)[0].position;
+	if (low == m_Count) return (*this)[m_Count - 1].position;
+
+	// interpolate between the frames either side of the timestamp
+	const PlayerStateFrame& older = (*this)[low];
+	const PlayerStateFrame& newer = (*this)[low - 1];
+	float interpolation = (timestamp - older.sendTimestamp) / (newer.sendTimestamp - older.sendTimestamp);
+	return Lerp(older.position, newer.position, interpolation);
+}
+
+void PlayerStateHistory::BoundsSince(float timestamp, sf::Vector2f& min, sf::Vector2f& max) const
+{
+	assert(m_Count > 0 && "State history is empty!");
+
+	min = max = (*this)[0].position;
+
+	// positions are interpolated between frames, so the frames newer than the timestamp
+	// and the first frame at or before it bound everything in between
+	for (size_t i = 1; i < m_Count; i++)
+	{
+		if ((*this)[i - 1].sendTimestamp <= timestamp) break;
+
+		const sf::Vector2f& p = (*this)[i].position;
+		min.x = std::min(min.x, p.x);
+		min.y = std::min(min.y, p.y);
+		max.x = std::max(max.x, p.x);
+		max.y = std::max(max.y, p.y);
+	}
+}
+
+void PlayerStateHistory::PopOldest()
+{
+	m_Duration -= Oldest().dt;
+	m_Count--;
+}
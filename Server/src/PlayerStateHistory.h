@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Network\NetworkTypes.h"
+
+#include <vector>
+#include <cassert>
+
+
+// a fixed capacity ring buffer of a player's state frames, kept in order of send timestamp
+// storage is allocated once up front, and frames arriving in order are inserted and trimmed in constant time
+class PlayerStateHistory
+{
+public:
+	PlayerStateHistory();
+	~PlayerStateHistory() = default;
+
+	inline bool Empty() const { return m_Count == 0; }
+	inline size_t Size() const { return m_Count; }
+	// the total length of time covered by the history
+	inline float Duration() const { return m_Duration; }
+
+	// index 0 is the newest frame, Size() - 1 is the oldest
+	inline PlayerStateFrame& operator[](size_t i) { assert(i < m_Count && "Index out of range!"); return m_Frames[PhysicalIndex(i)]; }
+	inline const PlayerStateFrame& operator[](size_t i) const { assert(i < m_Count && "Index out of range!"); return m_Frames[PhysicalIndex(i)]; }
+
+	inline PlayerStateFrame& Newest() { return (*this)[0]; }
+	inline PlayerStateFrame& Oldest() { return (*this)[m_Count - 1]; }
+
+	// add a frame to the history in timestamp order
+	// udp may deliver frames out of order, but they will only ever be slightly late,
+	// so the search for where to insert starts from the newest frame
+	void Insert(const PlayerStateFrame& frame);
+	// remove history so that it covers at most maxDuration seconds
+	void Trim(float maxDuration);
+
+	// get the position at a point in time, interpolating between the frames either side of it
+	sf::Vector2f PositionAtTime(float timestamp) const;
+	// get the box containing every position PositionAtTime could return for a timestamp at or after the one given
+	void BoundsSince(float timestamp, sf::Vector2f& min, sf::Vector2f& max) const;
+
+private:
+	inline size_t PhysicalIndex(size_t i) const { return (m_Newest - i) & m_Mask; }
+	void PopOldest();
+
+private:
+	std::vector<PlayerStateFrame> m_Frames;
+	size_t m_Mask = 0;
+
+	size_t m_Newest = 0; // physical index of the newest frame
+	size_t m_Count = 0;
+
+	// running total of the dt of every frame in the history
+	float m_Duration = 0.0f;
+};
@@ -0,0 +1,260 @@
+#include "ProjectileKernels.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROJECTILE_KERNELS_X86
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// msvc will emit any intrinsic without the instruction set being enabled for the whole file
+#define TARGET_AVX2
+#else
+#include <cpuid.h>
+// gcc and clang have to be told which functions can use AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+
+// scalar versions, used on any cpu and for the projectiles left over after the vector loops
+
+static void IntegrateProjectilesScalar(float* x, float* y, float* previousX, float* previousY, const float* directionX, const float* directionY, size_t begin, size_t count, float distance)
+{
+	for (size_t i = begin; i < count; i++)
+	{
+		previousX[i] = x[i];
+		previousY[i] = y[i];
+		x[i] += directionX[i] * distance;
+		y[i] += directionY[i] * distance;
+	}
+}
+
+static void OverlapProjectilesWithPlayersScalar(const float* previousX, const float* previousY, const float* x, const float* y, size_t begin, size_t count, float radius,
+												const PlayerBoundsBatch& players, PlayerMask* masks)
+{
+	for (size_t i = begin; i < count; i++)
+	{
+		// bounds of the path the projectile took this step
+		float minX = std::min(previousX[i], x[i]) - radius;
+		float minY = std::min(previousY[i], y[i]) - radius;
+		float maxX = std::max(previousX[i], x[i]) + radius;
+		float maxY = std::max(previousY[i], y[i]) + radius;
+
+		PlayerMask mask = 0;
+		for (size_t p = 0; p < players.count; p++)
+		{
+			if (minX <= players.maxX[p] && maxX >= players.minX[p] && minY <= players.maxY[p] && maxY >= players.minY[p])
+				mask |= PlayerMask(1) << p;
+		}
+		masks[i] = mask;
+	}
+}
+
+
+#ifdef PROJECTILE_KERNELS_X86
+
+// SSE2 is part of x64, so these are always available there
+
+static void IntegrateProjectilesSSE2(float* x, float* y, float* previousX, float* previousY, const float* directionX, const float* directionY, size_t count, float distance)
+{
+	const __m128 d = _mm_set1_ps(distance);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		_mm_storeu_ps(previousX + i, px);
+		_mm_storeu_ps(previousY + i, py);
+		_mm_storeu_ps(x + i, _mm_add_ps(px, _mm_mul_ps(_mm_loadu_ps(directionX + i), d)));
+		_mm_storeu_ps(y + i, _mm_add_ps(py, _mm_mul_ps(_mm_loadu_ps(directionY + i), d)));
+	}
+
+	IntegrateProjectilesScalar(x, y, previousX, previousY, directionX, directionY, i, count, distance);
+}
+
+static void OverlapProjectilesWithPlayersSSE2(const float* previousX, const float* previousY, const float* x, const float* y, size_t count, float radius,
+											  const PlayerBoundsBatch& players, PlayerMask* masks)
+{
+	const __m128 r = _mm_set1_ps(radius);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x0 = _mm_loadu_ps(previousX + i);
+		__m128 y0 = _mm_loadu_ps(previousY + i);
+		__m128 x1 = _mm_loadu_ps(x + i);
+		__m128 y1 = _mm_loadu_ps(y + i);
+
+		__m128 minX = _mm_sub_ps(_mm_min_ps(x0, x1), r);
+		__m128 minY = _mm_sub_ps(_mm_min_ps(y0, y1), r);
+		__m128 maxX = _mm_add_ps(_mm_max_ps(x0, x1), r);
+		__m128 maxY = _mm_add_ps(_mm_max_ps(y0, y1), r);
+
+		// each player is tested against four projectiles at once
+		// the comparison gives all ones in the lanes that overlap, which selects that player's bit
+		__m128i mask = _mm_setzero_si128();
+		for (size_t p = 0; p < players.count; p++)
+		{
+			__m128 overlap = _mm_and_ps(
+				_mm_and_ps(_mm_cmple_ps(minX, _mm_set1_ps(players.maxX[p])), _mm_cmpge_ps(maxX, _mm_set1_ps(players.minX[p]))),
+				_mm_and_ps(_mm_cmple_ps(minY, _mm_set1_ps(players.maxY[p])), _mm_cmpge_ps(maxY, _mm_set1_ps(players.minY[p]))));
+
+			__m128i bit = _mm_set1_epi32(static_cast<int>(PlayerMask(1) << p));
+			mask = _mm_or_si128(mask, _mm_and_si128(_mm_castps_si128(overlap), bit));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(masks + i), mask);
+	}
+
+	OverlapProjectilesWithPlayersScalar(previousX, previousY, x, y, i, count, radius, players, masks);
+}
+
+
+TARGET_AVX2 static void IntegrateProjectilesAVX2(float* x, float* y, float* previousX, float* previousY, const float* directionX, const float* directionY, size_t count, float distance)
+{
+	// multiply and add are kept separate (no FMA) so the results match the other versions exactly
+	const __m256 d = _mm256_set1_ps(distance);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		_mm256_storeu_ps(previousX + i, px);
+		_mm256_storeu_ps(previousY + i, py);
+		_mm256_storeu_ps(x + i, _mm256_add_ps(px, _mm256_mul_ps(_mm256_loadu_ps(directionX + i), d)));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(py, _mm256_mul_ps(_mm256_loadu_ps(directionY + i), d)));
+	}
+
+	IntegrateProjectilesScalar(x, y, previousX, previousY, directionX, directionY, i, count, distance);
+}
+
+TARGET_AVX2 static void OverlapProjectilesWithPlayersAVX2(const float* previousX, const float* previousY, const float* x, const float* y, size_t count, float radius,
+														  const PlayerBoundsBatch& players, PlayerMask* masks)
+{
+	const __m256 r = _mm256_set1_ps(radius);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x0 = _mm256_loadu_ps(previousX + i);
+		__m256 y0 = _mm256_loadu_ps(previousY + i);
+		__m256 x1 = _mm256_loadu_ps(x + i);
+		__m256 y1 = _mm256_loadu_ps(y + i);
+
+		__m256 minX = _mm256_sub_ps(_mm256_min_ps(x0, x1), r);
+		__m256 minY = _mm256_sub_ps(_mm256_min_ps(y0, y1), r);
+		__m256 maxX = _mm256_add_ps(_mm256_max_ps(x0, x1), r);
+		__m256 maxY = _mm256_add_ps(_mm256_max_ps(y0, y1), r);
+
+		__m256i mask = _mm256_setzero_si256();
+		for (size_t p = 0; p < players.count; p++)
+		{
+			__m256 overlap = _mm256_and_ps(
+				_mm256_and_ps(_mm256_cmp_ps(minX, _mm256_set1_ps(players.maxX[p]), _CMP_LE_OQ), _mm256_cmp_ps(maxX, _mm256_set1_ps(players.minX[p]), _CMP_GE_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(minY, _mm256_set1_ps(players.maxY[p]), _CMP_LE_OQ), _mm256_cmp_ps(maxY, _mm256_set1_ps(players.minY[p]), _CMP_GE_OQ)));
+
+			__m256i bit = _mm256_set1_epi32(static_cast<int>(PlayerMask(1) << p));
+			mask = _mm256_or_si256(mask, _mm256_and_si256(_mm256_castps_si256(overlap), bit));
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(masks + i), mask);
+	}
+
+	OverlapProjectilesWithPlayersScalar(previousX, previousY, x, y, i, count, radius, players, masks);
+}
+
+
+static bool CpuSupportsAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+
+	// the cpu has to support AVX and the os has to save the ymm registers on context switches
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx) return false;
+	if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+
+// the kernels for the instruction set in use, picked the first time they are needed
+struct ProjectileKernels
+{
+	SimdLevel level = SimdLevel::Scalar;
+	void (*integrate)(float*, float*, float*, float*, const float*, const float*, size_t, float) = nullptr;
+	void (*overlap)(const float*, const float*, const float*, const float*, size_t, float, const PlayerBoundsBatch&, PlayerMask*) = nullptr;
+
+	ProjectileKernels()
+	{
+		integrate = [](float* x, float* y, float* previousX, float* previousY, const float* directionX, const float* directionY, size_t count, float distance)
+		{
+			IntegrateProjectilesScalar(x, y, previousX, previousY, directionX, directionY, 0, count, distance);
+		};
+		overlap = [](const float* previousX, const float* previousY, const float* x, const float* y, size_t count, float radius, const PlayerBoundsBatch& players, PlayerMask* masks)
+		{
+			OverlapProjectilesWithPlayersScalar(previousX, previousY, x, y, 0, count, radius, players, masks);
+		};
+
+#ifdef PROJECTILE_KERNELS_X86
+		if (CpuSupportsAVX2())
+		{
+			level = SimdLevel::AVX2;
+			integrate = IntegrateProjectilesAVX2;
+			overlap = OverlapProjectilesWithPlayersAVX2;
+		}
+		else
+		{
+			level = SimdLevel::SSE2;
+			integrate = IntegrateProjectilesSSE2;
+			overlap = OverlapProjectilesWithPlayersSSE2;
+		}
+#endif
+	}
+};
+
+static const ProjectileKernels& GetKernels()
+{
+	static const ProjectileKernels s_Kernels;
+	return s_Kernels;
+}
+
+
+SimdLevel GetSimdLevel()
+{
+	return GetKernels().level;
+}
+
+const char* SimdLevelToStr(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::Scalar:	return "Scalar";
+	case SimdLevel::SSE2:	return "SSE2";
+	case SimdLevel::AVX2:	return "AVX2";
+	default:				return "Unknown";
+	}
+}
+
+void IntegrateProjectiles(float* x, float* y, float* previousX, float* previousY, const float* directionX, const float* directionY, size_t count, float distance)
+{
+	GetKernels().integrate(x, y, previousX, previousY, directionX, directionY, count, distance);
+}
+
+void OverlapProjectilesWithPlayers(const float* previousX, const float* previousY, const float* x, const float* y, size_t count, float radius,
+								   const PlayerBoundsBatch& players, PlayerMask* masks)
+{
+	GetKernels().overlap(previousX, previousY, x, y, count, radius, players, masks);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Constants.h"
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+
+
+// batched kernels that run over every projectile at once
+// they work on the structure of arrays in the ProjectilePool, and process several projectiles per instruction where the cpu allows
+// the instruction set is picked at runtime, so the same build runs (more slowly) on cpus without AVX2
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+// the best instruction set the kernels can use on this cpu
+SimdLevel GetSimdLevel();
+const char* SimdLevelToStr(SimdLevel level);
+
+
+// one bit per player, bit p set means the projectile may have hit player p
+using PlayerMask = sf::Uint32;
+static_assert(MAX_NUM_PLAYERS <= sizeof(PlayerMask) * 8, "Too many players to fit in a mask!");
+
+// the area each player could have been in over the window of time projectiles are checked against, as a structure of arrays
+struct PlayerBoundsBatch
+{
+	size_t count = 0;
+	float minX[MAX_NUM_PLAYERS];
+	float minY[MAX_NUM_PLAYERS];
+	float maxX[MAX_NUM_PLAYERS];
+	float maxY[MAX_NUM_PLAYERS];
+};
+
+
+// move every projectile distance units along its direction, storing where it was in previous
+void IntegrateProjectiles(float* x, float* y, float* previousX, float* previousY, const float* directionX, const float* directionY, size_t count, float distance);
+
+// broad phase for projectile/player collisions
+// for each projectile, set a bit in masks for every player whose bounds the projectile's swept path (padded by radius) overlaps
+// this is conservative: only the players in the mask need the exact (and much more expensive) rewound swept test
+void OverlapProjectilesWithPlayers(const float* previousX, const float* previousY, const float* x, const float* y, size_t count, float radius,
+								   const PlayerBoundsBatch& players, PlayerMask* masks);
@@ -0,0 +1,1037 @@
+#include "Room.h"
+
+#include "NetworkIOThread.h"
+#include "Log.h"
+#include "Trace.h"
+#include "MathUtils.h"
+#include "Network/NetworkTypes.h"
+
+#include <cmath>
+
+
+Room::Room(unsigned int id, NetworkIOThread& network)
+	: m_ID(id), m_Network(network)
+{
+	// set aside enough spaces in the vectors for clients
+	m_Clients.reserve(MAX_NUM_PLAYERS);
+	m_DepartedClients.reserve(MAX_NUM_PLAYERS);
+
+	// the inbox can take a whole batch, in case every datagram this tick was for this room
+	m_UdpInbox.reserve(MAX_UDP_DATAGRAMS_PER_TICK);
+	m_BlockQueryResults.reserve(MAX_NUM_BLOCKS);
+	m_ProjectilePlayerMasks.reserve(MAX_NUM_PROJECTILES);
+	m_DestroyedProjectiles.ids.reserve(MAX_NUM_PROJECTILES);
+	m_DestroyedBlocks.ids.reserve(MAX_NUM_BLOCKS);
+	m_WorldChunk.blocks.reserve(WORLD_CHUNK_MAX_BLOCKS);
+	m_SnapshotMessages.resize(SNAPSHOT_BUFFER_SIZE + 1, BroadcastMessage{ MessageCode::Update });
+
+	// create the blocks around spawn
+	const int blockCount = 11;
+	for (int i = 0; i < blockCount; i++)
+	{
+		AddBlock(NextBlockID(), PlayerTeam::None, { SPAWN_WIDTH - 0.5f * BLOCK_SIZE,				0.5f * WORLD_HEIGHT - (BLOCK_SIZE * (blockCount / 2)) + BLOCK_SIZE * i });
+		AddBlock(NextBlockID(), PlayerTeam::None, { WORLD_WIDTH - SPAWN_WIDTH + 0.5f * BLOCK_SIZE,	0.5f * WORLD_HEIGHT - (BLOCK_SIZE * (blockCount / 2)) + BLOCK_SIZE * i });
+	}
+
+	LOG_INFO("Room {} opened", m_ID);
+}
+
+Room::~Room()
+{
+	// the clients still in the room are owned by the server, it cleans them up
+}
+
+void Room::Update(float dt, float serverTime, const sf::SocketSelector& selector)
+{
+	ProfileScope updateScope{ m_Profiler, ServerPhase::RoomUpdate };
+
+	m_ServerTime = serverTime;
+
+	// update game objects and game state
+	StepSimulation(dt);
+
+	// process the udp data the server routed here
+	DispatchUdpInbox();
+
+	// clients may be removed from the vector while iterating,
+	// so only advance when the current client is still connected
+	sf::Int64 receiveBegin = m_Profiler.Begin();
+	for (size_t i = 0; i < m_Clients.size();)
+	{
+		Connection* client = m_Clients[i];
+
+		// increment idle timer
+		client->IncreaseIdleTimer(dt);
+
+		// only service clients that actually have data waiting
+		bool connected = true;
+		if (selector.isReady(client->GetSocket()))
+			connected = ProcessIncomingTcp(client);
+
+		// query idle timer
+		if (connected && client->GetIdleTimer() > IDLE_TIMEOUT)
+		{
+			// disconnect this client for being idle
+			LOG_INFO("Client {0} timed out, disconnecting...", client->GetID());
+			ProcessDisconnect(client);
+			connected = false;
+		}
+
+		if (connected) i++;
+	}
+	m_Profiler.End(ServerPhase::TcpReceive, receiveBegin);
+
+	// update timer - sending out regular updates to all clients
+	m_UpdateTimer += dt;
+	if (m_UpdateTimer > UPDATE_FREQUENCY)
+	{
+		ProfileScope scope{ m_Profiler, ServerPhase::Snapshot };
+		BroadcastSnapshot();
+		m_UpdateTimer -= UPDATE_FREQUENCY;
+	}
+
+	// ping the clients that are due one, to measure their latency
+	{
+		ProfileScope scope{ m_Profiler, ServerPhase::Ping };
+
+		for (auto client : m_Clients)
+		{
+			// a ping the client can't be sent would only be counted as lost
+			if (!client->CanSendUdp() || !client->IsPingDue(m_ServerTime)) continue;
+
+			// the tick started a while ago, after simulating and waiting its turn on the worker pool
+			// so the ping is stamped now, otherwise every round trip would include that time too
+			PingMessage ping = client->BeginPing(m_Network.GetTime());
+			SendMessageToClientUdp(client, MessageCode::Ping, ping);
+		}
+	}
+
+	{
+		ProfileScope scope{ m_Profiler, ServerPhase::WorldStream };
+		StreamWorldState();
+	}
+
+	// everything reliable that happened this tick goes out together
+	{
+		ProfileScope scope{ m_Profiler, ServerPhase::TcpFlush };
+		FlushOutgoingTcp();
+	}
+}
+
+void Room::QueueMessage(Connection* client, UdpMessage& message)
+{
+	m_UdpInbox.push_back({ client, &message });
+}
+
+void Room::DispatchUdpInbox()
+{
+	ProfileScope scope{ m_Profiler, ServerPhase::UdpDispatch };
+
+	for (auto& routed : m_UdpInbox)
+	{
+		Connection* client = routed.client;
+		const UdpMessage& message = *routed.message;
+
+		client->GetStats().OnReceived(message.header.messageCode, message.size);
+
+		// call appropriate callback
+		// latency is measured to when the ping reply arrived, not to when the room got round to it
+		switch (message.header.messageCode)
+		{
+		case MessageCode::Update:	ProcessUpdate(client, message.update, message.receiveTime); break;
+		case MessageCode::Ping:		ProcessPingReply(client, message.ping, message.receiveTime); break;
+		default:					break;
+		}
+
+		// also reset idle timer when any udp data is received
+		client->ResetIdleTimer();
+	}
+
+	m_UdpInbox.clear();
+}
+
+void Room::ResetStats()
+{
+	m_SnapshotStats = SnapshotStats{};
+	m_TcpStats = TcpSendStats{};
+	m_SimulationStats = SimulationStats{};
+	m_Profiler.Reset();
+}
+
+void Room::AddClient(Connection* client)
+{
+	// calculate their player number
+	sf::Uint8 playerNumber = static_cast<sf::Uint8>(m_Clients.size() + 1);
+	client->SetPlayerNumber(playerNumber);
+
+	// tell the client their ID
+	ConnectMessage connectMessage;
+	connectMessage.playerNumber = playerNumber;
+
+	// assign their team
+	if (m_RedTeamPlayerCount < m_BlueTeamPlayerCount)
+	{
+		client->SetPlayerTeam(PlayerTeam::Red);
+		m_RedTeamPlayerCount++;
+	}
+	else
+	{
+		client->SetPlayerTeam(PlayerTeam::Blue);
+		m_BlueTeamPlayerCount++;
+	}
+	connectMessage.team = client->GetPlayerTeam();
+
+	// tell them about the current world state
+	connectMessage.players.reserve(m_Clients.size());
+	for (auto c : m_Clients)
+		connectMessage.players.push_back({ c->GetID(), c->GetPlayerTeam() });
+
+	connectMessage.gameState = m_GameState;
+	connectMessage.remainingStateDuration = m_StateDuration - m_StateTimer;
+	connectMessage.turfLine = m_TurfLine;
+
+	// send the world state to the client
+	// the blocks follow over the next few ticks, so a full map doesn't go out in one burst
+	client->SendMessageTcp(MessageCode::Connect, connectMessage);
+	client->BeginWorldStream(m_NextBlockID);
+
+	// tell all other clients a new player has connected
+	PlayerConnectedMessage playerConnectedMessage{ client->GetID(), client->GetPlayerTeam() };
+	BroadcastMessageTcp(MessageCode::PlayerConnected, playerConnectedMessage);
+
+	// spread the clients' pings across the ping interval, rather than pinging everyone on the same tick
+	// ids are handed out in order, and multiples of the golden ratio are evenly spread however many clients there are
+	float pingOffset = std::fmod(client->GetID() * 0.618034f, 1.0f);
+	client->SchedulePings(m_ServerTime + pingOffset * PING_FREQUENCY);
+
+	// add to collection of clients
+	m_Clients.push_back(client);
+	LOG_INFO("[Player Joined] Room: {0} Player: {1} ID: {2} IP: {3} ", m_ID, playerNumber, client->GetID(), client->GetIP().toString());
+}
+
+float Room::TimeUntilNextEvent() const
+{
+	// work out how long the server can sleep before one of this room's timers is due
+	float timeout = UPDATE_FREQUENCY - m_UpdateTimer;
+
+	if (m_GameState != GameState::Lobby)
+		timeout = std::min(timeout, m_StateDuration - m_StateTimer);
+
+	if (!m_Clients.empty())
+	{
+		// wake up in time to time out the longest idle client, and for the next ping
+		float maxIdle = 0.0f;
+		float nextPing = m_ServerTime + PING_FREQUENCY;
+		for (auto client : m_Clients)
+		{
+			maxIdle = std::max(maxIdle, client->GetIdleTimer());
+			// clients that haven't introduced themselves over udp yet aren't pinged, so their ping is always overdue
+			if (client->CanSendUdp())
+				nextPing = std::min(nextPing, client->GetNextPingTime());
+		}
+		timeout = std::min(timeout, IDLE_TIMEOUT - maxIdle);
+		timeout = std::min(timeout, nextPing - m_ServerTime);
+	}
+
+	// the selector only wakes up for sockets that can be read from,
+	// so keep retrying while there is data waiting for a socket to accept it
+	// (and keep streaming the world to clients that are joining)
+	for (auto client : m_Clients)
+	{
+		if (client->HasQueuedTcp() || client->IsStreamingWorld())
+		{
+			timeout = std::min(timeout, TCP_SEND_RETRY_INTERVAL);
+			break;
+		}
+	}
+
+	// wake up for the next simulation step while there is something to simulate
+	if (!SimulationIdle())
+		timeout = std::min(timeout, SIMULATION_TIMESTEP - m_SimulationAccumulator);
+
+	return timeout;
+}
+
+void Room::StepSimulation(float dt)
+{
+	// advance the simulation in fixed steps so that it behaves the same regardless of how often the loop runs
+	m_SimulationAccumulator += dt;
+
+	if (SimulationIdle())
+	{
+		// nothing moves in the lobby, so the simulation clock can be advanced without doing any work
+		float steps = std::floor(m_SimulationAccumulator / SIMULATION_TIMESTEP);
+		m_SimulationTime += steps * SIMULATION_TIMESTEP;
+		m_SimulationAccumulator -= steps * SIMULATION_TIMESTEP;
+		return;
+	}
+
+	unsigned int steps = 0;
+	while (m_SimulationAccumulator >= SIMULATION_TIMESTEP)
+	{
+		if (steps == MAX_SIMULATION_STEPS_PER_FRAME)
+		{
+			// the server has fallen too far behind to catch up
+			// skip the remaining steps rather than spending ever longer simulating,
+			// but the clock still has to keep up with real time, clients are synced to it
+			unsigned int dropped = static_cast<unsigned int>(m_SimulationAccumulator / SIMULATION_TIMESTEP);
+			m_SimulationStats.droppedSteps += dropped;
+			m_SimulationTime += dropped * SIMULATION_TIMESTEP;
+			m_SimulationAccumulator -= dropped * SIMULATION_TIMESTEP;
+			break;
+		}
+
+		float tickStart = m_TickClock.getElapsedTime().asSeconds();
+
+		m_SimulationTime += SIMULATION_TIMESTEP;
+		{
+			ProfileScope scope{ m_Profiler, ServerPhase::SimulateObjects };
+			SimulateGameObjects(SIMULATION_TIMESTEP);
+		}
+		{
+			ProfileScope scope{ m_Profiler, ServerPhase::UpdateGameState };
+			UpdateGameState(SIMULATION_TIMESTEP);
+		}
+
+		m_SimulationAccumulator -= SIMULATION_TIMESTEP;
+		steps++;
+
+		// record how long the tick took
+		float tickTime = m_TickClock.getElapsedTime().asSeconds() - tickStart;
+		m_SimulationStats.ticks++;
+		m_SimulationStats.totalTickTime += tickTime;
+		m_SimulationStats.maxTickTime = std::max(m_SimulationStats.maxTickTime, tickTime);
+		if (tickTime > SIMULATION_TIMESTEP)
+			m_SimulationStats.overruns++;
+	}
+}
+
+bool Room::ProcessIncomingTcp(Connection* client)
+{
+	// receive every complete packet the client has sent
+	// returns false if the client was disconnected while processing
+	while (true)
+	{
+		sf::Socket::Status status = client->GetSocket().receive(m_ReceivePacket);
+		if (status == sf::Socket::Done)
+		{
+			// data was recieved
+			PacketReader packet{ m_ReceivePacket };
+			MessageHeader header;
+			packet >> header;
+
+			TRACE_SCOPE("Room::ProcessMessage", TraceArg{ "client", client->GetID() }, TraceArg{ "code", MessageCodeToStr(header.messageCode) });
+			client->GetStats().OnReceived(header.messageCode, m_ReceivePacket.getDataSize());
+
+			// reset idle timer
+			client->ResetIdleTimer();
+
+			// call appropriate callback
+			switch (header.messageCode)
+			{
+			case MessageCode::Introduction:			ProcessIntroduction(client, packet);	break;
+			case MessageCode::Disconnect:			ProcessDisconnect(client);				return false;
+			case MessageCode::ChangeTeam:			ProcessChangeTeam(client);				break;
+			case MessageCode::GetServerTime:		ProcessGetServerTime(client);			break;
+			case MessageCode::Shoot:				ProcessShootRequest(client, packet);	break;
+			case MessageCode::Place:				ProcessPlaceRequest(client, packet);	break;
+			case MessageCode::GameStart:			ProcessGameStartRequest(client);		break;
+				// these messages are sent from the server to clients, so it would be incorrect for the server to recieve them
+			case MessageCode::Connect:
+			case MessageCode::PlayerConnected:
+			case MessageCode::PlayerDisconnected:
+			case MessageCode::ShootRequestDenied:
+			case MessageCode::PlaceRequestDenied:
+			case MessageCode::PlayerDeath:
+			case MessageCode::ProjectilesDestroyed:
+			case MessageCode::BlocksDestroyed:
+			case MessageCode::ChangeGameState:
+			case MessageCode::TurfLineMoved:
+													LOG_WARN("Received invalid message code"); break;
+			case MessageCode::Update:
+			case MessageCode::Ping:
+													LOG_WARN("Received update message via TCP; updates should be sent via UDP"); break;
+
+			default:								LOG_WARN("Unknown message code: {}", static_cast<int>(header.messageCode)); break;
+			}
+		}
+		else if (status == sf::Socket::Error)
+		{
+			// the socket would keep reporting as ready, so drop the client rather than spin on it
+			LOG_ERROR("Error occurred while receiving messages from client {0}! Cleaning up...", client->GetID());
+			ProcessDisconnect(client);
+			return false;
+		}
+		else if (status == sf::Socket::Disconnected)
+		{
+			LOG_WARN("Client {0} unexpectedly disconnected! Cleaning up...", client->GetID());
+			// clean up; disconnect the client
+			ProcessDisconnect(client);
+			return false;
+		}
+		else
+		{
+			// NotReady or Partial: no more complete packets for now
+			return true;
+		}
+	}
+}
+
+void Room::FlushOutgoingTcp()
+{
+	// clients may be removed from the vector while flushing,
+	// so only advance when the current client is still connected
+	for (size_t i = 0; i < m_Clients.size();)
+	{
+		Connection* client = m_Clients[i];
+
+		// a client that has fallen so far behind that its messages have been dropped can't be brought back in sync
+		if (client->HasSendOverflowed())
+		{
+			LOG_WARN("Client {} is not receiving fast enough, disconnecting...", client->GetID());
+			m_TcpStats.overflowDisconnects++;
+			ProcessDisconnect(client);
+			continue;
+		}
+
+		if (client->HasQueuedTcp())
+		{
+			size_t queuedBytes = client->GetQueuedTcpBytes();
+			m_TcpStats.messages += client->GetQueuedTcpMessages();
+			m_TcpStats.peakQueuedBytes = std::max(m_TcpStats.peakQueuedBytes, queuedBytes);
+
+			// this never blocks: anything the socket won't take stays queued until next time
+			auto status = client->FlushTcp();
+			m_TcpStats.flushes++;
+			m_TcpStats.totalBytes += queuedBytes - client->GetQueuedTcpBytes();
+			if (status == sf::Socket::Partial || status == sf::Socket::NotReady)
+				m_TcpStats.partialFlushes++;
+		}
+
+		i++;
+	}
+}
+
+void Room::BroadcastSnapshot()
+{
+	// take a snapshot of every player's most recent state
+	// sequence numbers skip NO_SNAPSHOT when they wrap around
+	if (++m_SnapshotSequence == NO_SNAPSHOT) m_SnapshotSequence++;
+	Snapshot& snapshot = m_Snapshots[m_SnapshotSequence % SNAPSHOT_BUFFER_SIZE];
+	snapshot.Clear(m_SnapshotSequence, GetSimulationClock());
+
+	for (auto client : m_Clients)
+	{
+		if (client->StateQueueEmpty()) continue;
+
+		PlayerStateFrame& ps = client->GetCurrentPlayerState();
+		snapshot.players[client->GetID()].Quantise(ps.position, ps.rotation);
+	}
+	m_SnapshotStats.snapshots++;
+
+	// which encoded messages have been written for this snapshot
+	bool encoded[SNAPSHOT_BUFFER_SIZE + 1] = {};
+
+	for (auto client : m_Clients)
+	{
+		if (!client->CanSendUdp()) continue;
+
+		// delta-encode against the most recent snapshot the client has acknowledged, as long as we still have it
+		// otherwise the client is sent every player in full
+		const Snapshot* baseline = nullptr;
+		SnapshotSequence ack = client->GetAckedSnapshot();
+		if (ack != NO_SNAPSHOT && ack != m_SnapshotSequence)
+		{
+			const Snapshot& candidate = m_Snapshots[ack % SNAPSHOT_BUFFER_SIZE];
+			if (candidate.sequence == ack) baseline = &candidate;
+		}
+
+		// clients that acknowledged the same snapshot share the same message
+		size_t messageIndex = baseline ? ack % SNAPSHOT_BUFFER_SIZE : SNAPSHOT_BUFFER_SIZE;
+		BroadcastMessage& message = m_SnapshotMessages[messageIndex];
+		if (!encoded[messageIndex])
+		{
+			SnapshotHeader snapshotHeader{ m_SnapshotSequence, baseline ? ack : NO_SNAPSHOT, GetSimulationClock(), m_ServerTime };
+			message.Reset(MessageCode::Update);
+			message.GetPacket() << snapshotHeader;
+			WriteSnapshotDelta(message.GetPacket(), snapshot, baseline);
+			encoded[messageIndex] = true;
+		}
+
+		m_SnapshotStats.messages++;
+		if (baseline) m_SnapshotStats.deltaMessages++;
+		PacketWriter& packet = message.Address(client->GetID());
+		m_SnapshotStats.totalBytes += packet.GetDataSize();
+
+		SendPacketToClientUdp(client, packet);
+	}
+}
+
+void Room::SimulateGameObjects(float dt)
+{
+	bool gameOver = false;
+
+	// update the positions of all projectiles
+	m_Projectiles.SimulationStep(dt);
+
+	// find the area each player could have been seen in by any shooter
+	// a shooter is never rewound more than MAX_LAG_COMPENSATION into the past
+	m_PlayerBounds.count = 0;
+	for (auto client : m_Clients)
+	{
+		if (client->StateQueueEmpty()) continue;
+
+		sf::Vector2f min, max;
+		client->GetPlayerBoundsSince(m_SimulationTime - MAX_LAG_COMPENSATION, min, max);
+
+		size_t p = m_PlayerBounds.count++;
+		m_PlayerBounds.minX[p] = min.x;
+		m_PlayerBounds.minY[p] = min.y;
+		m_PlayerBounds.maxX[p] = max.x;
+		m_PlayerBounds.maxY[p] = max.y;
+		m_PlayerBoundsClients[p] = client;
+	}
+
+	// test every projectile against those areas at once, so that only the players a projectile came close to need rewinding
+	m_Projectiles.FindPlayerOverlaps(m_PlayerBounds, m_ProjectilePlayerMasks);
+
+	// check projectiles for collisions
+	// iterate backwards so that the projectile moved into the place of a destroyed one has already been checked,
+	// and the masks of the projectiles still to be checked stay at the same indices
+	for (size_t i = m_Projectiles.Size(); i-- > 0;)
+	{
+		const sf::Vector2f position = m_Projectiles.GetPosition(i);
+		const sf::Vector2f previousPosition = m_Projectiles.GetPreviousPosition(i);
+		const PlayerTeam team = m_Projectiles.GetTeam(i);
+
+		// collisions are swept along the path the projectile took this step,
+		// and only the earliest thing it hit counts
+
+		// check if the projectile has hit a block
+		// only the blocks in the cells the projectile moved through this step need to be tested
+		ObjectHandle hitBlock = INVALID_OBJECT_HANDLE;
+		size_t hitBlockIndex = HandleTable::INVALID_INDEX;
+		float blockHitTime = 1.0f;
+		m_BlockGrid.QuerySweptCircle(previousPosition, position, PROJECTILE_RADIUS, m_BlockQueryResults);
+		for (auto block : m_BlockQueryResults)
+		{
+			size_t blockIndex = m_Blocks.IndexOf(block);
+			float t;
+			if (m_Projectiles.BlockCollision(i, m_Blocks.GetPosition(blockIndex), t) && (hitBlock == INVALID_OBJECT_HANDLE || t < blockHitTime))
+			{
+				hitBlock = block;
+				hitBlockIndex = blockIndex;
+				blockHitTime = t;
+			}
+		}
+
+		// check if this projectile has hit a player
+		Connection* hitPlayer = nullptr;
+		float playerHitTime = 1.0f;
+
+		// perform projectile collision calculations in the time frame of the player that shot the projectile
+		// the shooter sees the projectile RewindTime() seconds further along its path than the server does,
+		// which puts its server position this step exactly where the shooter sees it RewindTime() seconds ago
+		// so rewind the other players to where the shooter saw them at that moment
+		float viewTime = m_SimulationTime - m_Projectiles.RewindTime(i);
+
+		PlayerMask candidates = m_ProjectilePlayerMasks[i];
+		for (size_t p = 0; candidates; p++, candidates >>= 1)
+		{
+			if (!(candidates & 1)) continue;
+
+			Connection* client = m_PlayerBoundsClients[p];
+			if (client->GetPlayerTeam() == team) continue;
+
+			// check for collision with the player
+			float t;
+			if (m_Projectiles.PlayerCollision(i, client->GetPlayerPosAtTime(viewTime), t) && (!hitPlayer || t < playerHitTime))
+			{
+				hitPlayer = client;
+				playerHitTime = t;
+			}
+		}
+
+		// whichever was hit first stops the projectile
+		if (hitPlayer && hitBlock != INVALID_OBJECT_HANDLE)
+		{
+			if (playerHitTime <= blockHitTime)
+				hitBlock = INVALID_OBJECT_HANDLE;
+			else
+				hitPlayer = nullptr;
+		}
+
+		if (hitBlock != INVALID_OBJECT_HANDLE)
+		{
+			// destroy the block
+			PlayerTeam blockTeam = m_Blocks.GetTeam(hitBlockIndex);
+			if (blockTeam != team && blockTeam != PlayerTeam::None)
+				DestroyBlock(hitBlock);
+		}
+
+		if (hitPlayer)
+		{
+			// kill player
+			hitPlayer->SendMessageTcp(MessageCode::PlayerDeath);
+
+			// move turf line
+			float previousTurfLine = m_TurfLine;
+			m_TurfLine += m_RoundNum * BLOCK_SIZE * (team == PlayerTeam::Red ? 1 : - 1);
+			// check win condition
+			if (m_TurfLine <= SPAWN_WIDTH || m_TurfLine >= WORLD_WIDTH - SPAWN_WIDTH)
+			{
+				EndGame();
+				gameOver = true;
+			}
+
+			// transmit turf move to all players
+			TurfLineMoveMessage message{ m_TurfLine };
+			BroadcastMessageTcp(MessageCode::TurfLineMoved, message);
+
+			// moving the turf line may destroy a bunch of blocks
+			CheckForBlocksAcrossTurfLine(previousTurfLine);
+		}
+		if (gameOver) break;
+
+		// check if anything happened that should destroy the projectile
+		if (hitBlock != INVALID_OBJECT_HANDLE || hitPlayer || position.x - PROJECTILE_RADIUS < 0 || position.x + PROJECTILE_RADIUS > WORLD_WIDTH
+															  || position.y - PROJECTILE_RADIUS < 0 || position.y + PROJECTILE_RADIUS > WORLD_HEIGHT)
+			DestroyProjectile(i);
+	}
+
+	// tell clients about everything that was destroyed this step in one go
+	BroadcastDestroyedObjects();
+}
+
+void Room::UpdateGameState(float dt)
+{
+	// nothing to update in the lobby
+	if (m_GameState == GameState::Lobby) return;
+
+	// increment state timer
+	m_StateTimer += dt;
+
+	if (m_StateTimer > m_StateDuration)
+	{
+		// switch state!
+		m_StateTimer = 0.0f;
+
+		switch (m_GameState)
+		{
+		case GameState::Lobby: break;
+		case GameState::FightMode:
+			// configure for build mode
+			m_GameState = GameState::BuildMode;
+			m_StateDuration = m_BuildModeDuration;
+			m_FightModeDuration = std::max(m_FightModeDuration - 10.0f, MIN_FIGHT_MODE_DURATION);
+
+			break;
+		case GameState::BuildMode:	
+			// configure for fight mode
+			m_GameState = GameState::FightMode;
+			m_StateDuration = m_FightModeDuration;
+			m_BuildModeDuration = std::max(m_BuildModeDuration - 10.0f, MIN_BUILD_MODE_DURATION);
+			m_RoundNum++;
+
+			break;
+		default:
+			LOG_ERROR("Unknown game state"); break;
+		}
+
+		// kill all projectiles
+		m_Projectiles.Clear();
+
+		// tell all clients
+		ChangeGameStateMessage message{ m_GameState, m_StateDuration };
+		BroadcastMessageTcp(MessageCode::ChangeGameState, message);
+	}
+
+}
+
+void Room::StartGame()
+{
+	// set up initial game state
+	m_GameState = GameState::BuildMode;
+	m_StateDuration = INITIAL_BUILD_MODE_DURATION;
+	m_RoundNum = 0;
+
+	m_BuildModeDuration = INITIAL_BUILD_MODE_DURATION;
+	m_FightModeDuration = INITIAL_FIGHT_MODE_DURATION;
+
+	// reset turf line
+	m_TurfLine = 0.5f * WORLD_WIDTH;
+
+	// tell all clients the game has started
+	BroadcastMessageTcp(MessageCode::GameStart);
+	// reset ready flags
+	for (auto client : m_Clients)
+		client->SetReady(false);
+}
+
+void Room::EndGame()
+{
+	// anything destroyed before the game ended should reach clients before they go back to the lobby
+	BroadcastDestroyedObjects();
+
+	// reset game state
+	// send game back to the lobby
+	m_GameState = GameState::Lobby;
+	m_StateDuration = 0.0f;
+	m_StateTimer = 0.0f;
+	m_RoundNum = 0;
+
+	// tell all clients the game has ended
+	ChangeGameStateMessage message{ m_GameState, m_StateDuration };
+	BroadcastMessageTcp(MessageCode::ChangeGameState, message);
+	// reset ready flags
+	for (auto client : m_Clients)
+		client->SetReady(false);
+
+	// kill all projectiles
+	m_Projectiles.Clear();
+	// kill all blocks placed by players
+	// iterate backwards so that the block swapped into a removed block's place has already been checked
+	for (size_t i = m_Blocks.Size(); i-- > 0;)
+	{
+		if (m_Blocks.GetTeam(i) != PlayerTeam::None)
+			RemoveBlock(m_Blocks.HandleAt(i));
+	}
+}
+
+void Room::SendPacketToClientUdp(Connection* client, const PacketWriter& packet)
+{
+	// the network thread sends it, and counts anything that doesn't make it out
+	if (m_Network.SendUdp(m_ID, packet, client->GetIP(), client->GetUdpPort(), client->GetID()))
+		client->GetStats().OnSent(packet);
+}
+
+void Room::BroadcastTcp(BroadcastMessage& message)
+{
+	for (auto client : m_Clients)
+		client->SendBroadcastTcp(message);
+}
+
+void Room::DestroyProjectile(size_t index)
+{
+	// clients won't accept more ids than there can be projectiles, send what we have if it's full
+	if (m_DestroyedProjectiles.ids.size() == MAX_NUM_PROJECTILES)
+		BroadcastDestroyedObjects();
+
+	m_DestroyedProjectiles.ids.push_back(m_Projectiles.GetID(index));
+
+	m_Projectiles.Remove(index);
+}
+
+void Room::DestroyBlock(ObjectHandle block)
+{
+	size_t index = m_Blocks.IndexOf(block);
+	if (index == HandleTable::INVALID_INDEX) return;
+
+	if (m_DestroyedBlocks.ids.size() == MAX_NUM_BLOCKS)
+		BroadcastDestroyedObjects();
+
+	m_DestroyedBlocks.ids.push_back(m_Blocks.GetID(index));
+
+	RemoveBlock(block);
+}
+
+void Room::BroadcastDestroyedObjects()
+{
+	// tell all clients which objects have been destroyed since the last broadcast
+	if (!m_DestroyedProjectiles.ids.empty())
+	{
+		BroadcastMessageTcp(MessageCode::ProjectilesDestroyed, m_DestroyedProjectiles);
+		m_DestroyedProjectiles.ids.clear();
+	}
+	if (!m_DestroyedBlocks.ids.empty())
+	{
+		BroadcastMessageTcp(MessageCode::BlocksDestroyed, m_DestroyedBlocks);
+		m_DestroyedBlocks.ids.clear();
+	}
+}
+
+void Room::StreamWorldState()
+{
+	for (auto client : m_Clients)
+	{
+		if (!client->IsStreamingWorld()) continue;
+		// let a client that is behind catch up before giving it more
+		if (client->IsSendBacklogged()) continue;
+
+		// walk the grid from where the last chunk stopped until the chunk is full
+		// blocks placed since the client joined are skipped, it was sent those as they were placed
+		m_WorldChunk.startCell = client->GetWorldStreamCell();
+		m_WorldChunk.blocks.clear();
+
+		sf::Uint32 cell = m_WorldChunk.startCell;
+		for (; cell < m_BlockGrid.NumCells() && m_WorldChunk.blocks.size() < WORLD_CHUNK_MAX_BLOCKS; cell++)
+		{
+			ObjectHandle block = m_BlockGrid.AtCell(cell);
+			if (block == INVALID_OBJECT_HANDLE) continue;
+
+			size_t index = m_Blocks.IndexOf(block);
+			if (m_Blocks.GetID(index) >= client->GetWorldStreamIDLimit()) continue;
+
+			m_WorldChunk.blocks.push_back({ cell, m_Blocks.GetID(index), m_Blocks.GetTeam(index) });
+		}
+		m_WorldChunk.last = (cell == m_BlockGrid.NumCells());
+
+		client->SendMessageTcp(MessageCode::WorldChunk, m_WorldChunk);
+
+		if (m_WorldChunk.last)
+			client->EndWorldStream();
+		else
+			client->SetWorldStreamCell(cell);
+	}
+}
+
+void Room::AddBlock(BlockID id, PlayerTeam team, const sf::Vector2f& position)
+{
+	ObjectHandle block = m_Blocks.Add(id, team, position);
+	if (!m_BlockGrid.Insert(block, position))
+		LOG_ERROR("Block {} could not be added to the block grid!", id);
+}
+
+void Room::RemoveBlock(ObjectHandle block)
+{
+	size_t index = m_Blocks.IndexOf(block);
+	if (index == HandleTable::INVALID_INDEX) return;
+
+	m_BlockGrid.Remove(block, m_Blocks.GetPosition(index));
+	m_Blocks.Remove(index);
+}
+
+void Room::ProcessIntroduction(Connection* client, PacketReader& packet)
+{
+	IntroductionMessage introductionMessage;
+	packet >> introductionMessage;
+	client->SetUdpPort(introductionMessage.udpPort);
+}
+
+
+
+void Room::ProcessDisconnect(Connection* client)
+{
+	// acknowledge the clients requests to disconnect
+	client->SendMessageTcp(MessageCode::Disconnect);
+	client->FlushTcp();
+
+	if (client->GetPlayerTeam() == PlayerTeam::Red)
+		m_RedTeamPlayerCount--;
+	else
+		m_BlueTeamPlayerCount--;
+
+	// remove client from vector
+	auto it = m_Clients.begin();
+	for (; it != m_Clients.end(); it++)
+	{
+		if (*it == client) break;
+	}
+	m_Clients.erase(it);
+
+	// tell all other players a player disconnected
+	PlayerDisconnectedMessage playerDisconnectedMessage{ client->GetID() };
+	BroadcastMessageTcp(MessageCode::PlayerDisconnected, playerDisconnectedMessage);
+
+	// the server frees their id and deletes the client once the update is over
+	LOG_INFO("Player ID {0} disconnected from room {1}", client->GetID(), m_ID);
+	m_DepartedClients.push_back(client);
+}
+
+void Room::ProcessUpdate(Connection* client, const UpdateMessage& updateMessage, float receiveTime)
+{
+	if (updateMessage.playerID != client->GetID())
+	{
+		// just in case this manages to happen?
+		LOG_WARN("Client sending update data with incorrect client ID");
+		return;
+	}
+
+	// the client's simulation time runs at the same rate as the server's clock, which is all jitter needs
+	ConnectionStats& stats = client->GetStats();
+	stats.OnSequenceReceived(updateMessage.sequence);
+	stats.OnTransit(updateMessage.sendTime, receiveTime);
+
+	client->AddToStateQueue(updateMessage);
+	client->AcknowledgeSnapshot(updateMessage.snapshotAck);
+}
+
+void Room::ProcessPingReply(Connection* client, const PingMessage& pingMessage, float receiveTime)
+{
+	// replies to pings that were given up on, or duplicated by the network, are ignored
+	client->OnPingReply(pingMessage, receiveTime);
+}
+
+void Room::ProcessChangeTeam(Connection* client)
+{
+	// decide if the player is allowed to change team
+	// for now always allow
+	
+	// switch team
+	if (client->GetPlayerTeam() == PlayerTeam::Red)
+	{
+		client->SetPlayerTeam(PlayerTeam::Blue);
+		m_RedTeamPlayerCount--;
+		m_BlueTeamPlayerCount++;
+	}
+	else
+	{
+		client->SetPlayerTeam(PlayerTeam::Red);
+		m_RedTeamPlayerCount++;
+		m_BlueTeamPlayerCount--;
+	}
+
+	ChangeTeamMessage changeTeamMessage{ client->GetID(), client->GetPlayerTeam() };
+
+	// transmit this change to all clients
+	BroadcastMessageTcp(MessageCode::ChangeTeam, changeTeamMessage);
+}
+
+void Room::ProcessGetServerTime(Connection* client)
+{
+	ServerTimeMessage response{ GetSimulationClock() };
+	client->SendMessageTcp(MessageCode::GetServerTime, response);
+}
+
+void Room::ProcessShootRequest(Connection* client, PacketReader& packet)
+{
+	ShootMessage shootMessage;
+	packet >> shootMessage;
+
+	// check if the projectile can be spawned
+	if (VerifyProjecitleShoot({ shootMessage.x, shootMessage.y }, client->GetCurrentPlayerState()))
+	{
+		// create new projectile object
+		shootMessage.id = NextProjectileID();
+
+		m_Projectiles.Add(shootMessage, m_SimulationTime, m_SimulationTime - client->GetLatency());
+
+		// tell all clients a projectile has been shot
+		BroadcastMessageTcp(MessageCode::Shoot, shootMessage);
+	}
+	else
+	{
+		// tell the player their request has been denied
+		client->SendMessageTcp(MessageCode::ShootRequestDenied);
+	}
+}
+
+void Room::ProcessPlaceRequest(Connection* client, PacketReader& packet)
+{
+	PlaceMessage placeMessage;
+	packet >> placeMessage;
+
+	// blocks always sit on grid points
+	// clients already snap their requests, but the server has the final say
+	sf::Vector2f position = BlockGrid::Snap({ placeMessage.x, placeMessage.y });
+	placeMessage.x = position.x;
+	placeMessage.y = position.y;
+
+	// check if block can be placed
+	if (VerifyBlockPlacement({ placeMessage.x, placeMessage.y }, client->GetCurrentPlayerState(), client->GetPlayerTeam()))
+	{
+		// create new block
+		placeMessage.id = NextBlockID();
+		
+		AddBlock(placeMessage.id, placeMessage.team, position);
+
+		BroadcastMessageTcp(MessageCode::Place, placeMessage);
+	}
+	else
+	{
+		// tell the player their block place request has been rejected
+		client->SendMessageTcp(MessageCode::PlaceRequestDenied);
+	}
+}
+
+void Room::ProcessGameStartRequest(Connection* client)
+{
+	if (m_GameState != GameState::Lobby)
+	{
+		LOG_WARN("Cannot request game to start outside of lobby state!");
+		return;
+	}
+
+	client->SetReady(true);
+
+	// if all clients are ready then start the game
+	bool allReady = true;
+	for (auto c : m_Clients)
+		allReady &= c->IsReady();
+
+	if (allReady)
+		StartGame();
+}
+
+ProjectileID Room::NextProjectileID()
+{
+	return m_NextProjectileID++;
+}
+
+BlockID Room::NextBlockID()
+{
+	return m_NextBlockID++;
+}
+
+bool Room::VerifyProjecitleShoot(const sf::Vector2f& position, const PlayerStateFrame& player)
+{
+	// is the game not in fight mode
+	if (m_GameState != GameState::FightMode) return false;
+	// has max projectiles been exceeded
+	if (m_Projectiles.Size() == MAX_NUM_PROJECTILES) return false;
+
+	return true;
+}
+
+bool Room::VerifyBlockPlacement(const sf::Vector2f& position, const PlayerStateFrame& player, PlayerTeam team)
+{
+	// is the game not in build mode
+	if (m_GameState != GameState::BuildMode) return false;
+	// has max blocks been exceeded
+	if (m_Blocks.Size() == MAX_NUM_BLOCKS) return false;
+	// is the block inside the world
+	if (position.x < 0.0f || position.x > WORLD_WIDTH || position.y < 0.0f || position.y > WORLD_HEIGHT) return false;
+	// is the player close enough to the place position
+	if (Length(position - player.position) > BLOCK_PLACE_RADIUS) return false;
+	// is the block on the players own turf
+	if (!OnTeamTurf(position, team)) return false;
+	// is the block on top of any other players
+	for (auto c : m_Clients)
+		if (Length(position - c->GetCurrentPlayerState().position) < PLAYER_SIZE) return false;
+	// is the block on top of any other blocks
+	if (m_BlockGrid.At(position) != INVALID_OBJECT_HANDLE) return false;
+
+	return true;
+}
+
+bool Room::OnTeamTurf(const sf::Vector2f& p, PlayerTeam team)
+{
+	switch (team)
+	{
+	case PlayerTeam::None:	return true; // always allow team-less blocks (because theyll be server spawned)
+	case PlayerTeam::Red:	return p.x < m_TurfLine && p.x > SPAWN_WIDTH;
+	case PlayerTeam::Blue:	return p.x > m_TurfLine && p.x < WORLD_WIDTH - SPAWN_WIDTH;
+	default:				return false;
+	}
+
+	return false;
+}
+
+void Room::CheckForBlocksAcrossTurfLine(float previousTurfLine)
+{
+	// any blocks across the turf line will be destroyed
+
+	// only blocks between the old and new turf line can have ended up on the wrong side
+	sf::Vector2f min{ std::min(previousTurfLine, m_TurfLine), 0.0f };
+	sf::Vector2f max{ std::max(previousTurfLine, m_TurfLine), WORLD_HEIGHT };
+	m_BlockGrid.QueryArea(min, max, m_BlockQueryResults);
+
+	for (auto block : m_BlockQueryResults)
+	{
+		// this block is on the wrong side
+		// clients are informed along with everything else destroyed this step
+		size_t index = m_Blocks.IndexOf(block);
+		if (!OnTeamTurf(m_Blocks.GetPosition(index), m_Blocks.GetTeam(index)))
+			DestroyBlock(block);
+	}
+}
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include <algorithm>
+
+#include "Network/NetworkTypes.h"
+#include "Network/Snapshot.h"
+#include "GameObjects.h"
+#include "BlockGrid.h"
+#include "Connection.h"
+#include "PhaseProfiler.h"
+#include "Log.h"
+
+class NetworkIOThread;
+
+
+// a datagram that has been drained from the udp socket and decoded by the network thread, waiting to be dispatched
+// only updates and pings are sent via udp
+struct UdpMessage
+{
+	MessageHeader header;
+	// whichever matches the header's message code
+	UpdateMessage update;
+	PingMessage ping;
+
+	size_t size = 0; // bytes received, for the traffic stats
+	sf::IpAddress address;
+	unsigned short port = 0;
+	float receiveTime = 0.0f; // server time when it was read from the socket
+};
+
+// timing of the fixed-step simulation
+struct SimulationStats
+{
+	unsigned int ticks = 0;			// simulation steps since the last report
+	float totalTickTime = 0.0f;		// real time spent simulating (seconds)
+	float maxTickTime = 0.0f;		// longest single step (seconds)
+	unsigned int overruns = 0;		// steps that took longer than SIMULATION_TIMESTEP to run
+	unsigned int droppedSteps = 0;	// steps skipped because the server fell too far behind
+
+	void Add(const SimulationStats& other)
+	{
+		ticks += other.ticks;
+		totalTickTime += other.totalTickTime;
+		maxTickTime = std::max(maxTickTime, other.maxTickTime);
+		overruns += other.overruns;
+		droppedSteps += other.droppedSteps;
+	}
+};
+
+// how the reliable messages sent to clients are being batched together
+struct TcpSendStats
+{
+	unsigned int messages = 0;				// messages queued since the last report
+	unsigned int flushes = 0;				// sends made to get them out
+	unsigned int partialFlushes = 0;		// sends where the socket couldn't take everything that was queued
+	size_t totalBytes = 0;					// bytes sent
+	size_t peakQueuedBytes = 0;				// most bytes queued for a single client
+	unsigned int overflowDisconnects = 0;	// clients dropped for falling too far behind
+
+	void Add(const TcpSendStats& other)
+	{
+		messages += other.messages;
+		flushes += other.flushes;
+		partialFlushes += other.partialFlushes;
+		totalBytes += other.totalBytes;
+		peakQueuedBytes = std::max(peakQueuedBytes, other.peakQueuedBytes);
+		overflowDisconnects += other.overflowDisconnects;
+	}
+};
+
+// how much player state the server is sending out
+struct SnapshotStats
+{
+	unsigned int snapshots = 0;		// snapshots taken since the last report
+	unsigned int messages = 0;		// update messages sent
+	unsigned int deltaMessages = 0;	// update messages that were delta-encoded against an acknowledged snapshot
+	size_t totalBytes = 0;			// bytes of update messages sent
+
+	void Add(const SnapshotStats& other)
+	{
+		snapshots += other.snapshots;
+		messages += other.messages;
+		deltaMessages += other.deltaMessages;
+		totalBytes += other.totalBytes;
+	}
+};
+
+
+// a single match and the clients playing in it
+// rooms don't share any state, so every room can be updated on a different thread at the same time
+// the server owns the sockets: it accepts clients into rooms, and routes udp datagrams to the room their client is in
+class Room
+{
+public:
+	// udp is handed to the network thread to send
+	Room(unsigned int id, NetworkIOThread& network);
+	~Room();
+
+	inline unsigned int GetID() const { return m_ID; }
+	inline size_t NumClients() const { return m_Clients.size(); }
+	inline bool IsFull() const { return m_Clients.size() >= MAX_NUM_PLAYERS; }
+
+	// how long until this room next has work to do
+	float TimeUntilNextEvent() const;
+
+	// a client that has just connected joins the room
+	// called by the server between updates
+	void AddClient(Connection* client);
+	// a datagram from one of this room's clients, processed during the next update
+	// the datagram must stay alive until then
+	void QueueMessage(Connection* client, UdpMessage& message);
+
+	// everything the room does in a tick: simulate, service its clients' sockets, and send them what has changed
+	// serverTime is the real time used to measure latency, every room shares the same clock
+	void Update(float dt, float serverTime, const sf::SocketSelector& selector);
+
+	// clients that left during the last update
+	// they have been removed from the room, the server is responsible for cleaning them up
+	inline std::vector<Connection*>& GetDepartedClients() { return m_DepartedClients; }
+
+	// statistics gathered since the last report
+	inline const SimulationStats& GetSimulationStats() const { return m_SimulationStats; }
+	inline const TcpSendStats& GetTcpStats() const { return m_TcpStats; }
+	inline const SnapshotStats& GetSnapshotStats() const { return m_SnapshotStats; }
+	inline const PhaseProfiler& GetProfiler() const { return m_Profiler; }
+	void ResetStats();
+
+private:
+	// run as many fixed simulation steps as dt allows
+	void StepSimulation(float dt);
+	// send every client the reliable messages queued for them this tick
+	void FlushOutgoingTcp();
+	// take a snapshot of every player and send each client what has changed since the last snapshot it acknowledged
+	void BroadcastSnapshot();
+
+	// the lobby has nothing to simulate
+	inline bool SimulationIdle() const { return m_GameState == GameState::Lobby; }
+	// the simulation time plus the time that hasn't been simulated yet, which keeps pace with real time
+	// times sent to clients use this, the simulation time alone only moves in whole steps
+	inline float GetSimulationClock() const { return m_SimulationTime + m_SimulationAccumulator; }
+
+	// process executed every simulation step
+	void SimulateGameObjects(float dt);
+	void UpdateGameState(float dt);
+
+	// begin and end the game
+	void StartGame();
+	void EndGame();
+
+	// receive and dispatch all pending tcp messages from a client
+	// returns false if the client was disconnected
+	bool ProcessIncomingTcp(Connection* client);
+	// process the datagrams the server has routed to this room
+	void DispatchUdpInbox();
+
+	// destroyed objects are collected during a simulation step,
+	// and clients are told about all of them at once at the end of it
+	// destroying a projectile removes it from the pool, so the projectile at index is replaced by another
+	void DestroyProjectile(size_t index);
+	void DestroyBlock(ObjectHandle block);
+	void BroadcastDestroyedObjects();
+
+	// send the next chunk of the world to every client that is still joining
+	void StreamWorldState();
+
+	// add/remove blocks from both the block list and the block grid
+	void AddBlock(BlockID id, PlayerTeam team, const sf::Vector2f& position);
+	void RemoveBlock(ObjectHandle block);
+
+	// callbacks for messages
+	void ProcessIntroduction(Connection* client, PacketReader& packet);
+	void ProcessDisconnect(Connection* client);
+	void ProcessUpdate(Connection* client, const UpdateMessage& updateMessage, float receiveTime);
+	void ProcessPingReply(Connection* client, const PingMessage& pingMessage, float receiveTime);
+	void ProcessChangeTeam(Connection* client);
+	void ProcessGetServerTime(Connection* client);
+	void ProcessShootRequest(Connection* client, PacketReader& packet);
+	void ProcessPlaceRequest(Connection* client, PacketReader& packet);
+	void ProcessGameStartRequest(Connection* client);
+
+	// send via udp
+	template<typename T>
+	void SendMessageToClientUdp(Connection* client, MessageCode code, const T& message)
+	{
+		if (!client->CanSendUdp()) return;
+
+		m_UdpSendPacket.Clear();
+		m_UdpSendPacket << MessageHeader{ client->GetID(), code } << message;
+		SendPacketToClientUdp(client, m_UdpSendPacket);
+	}
+	void SendMessageToClientUdp(Connection* client, MessageCode code)
+	{
+		if (!client->CanSendUdp()) return;
+
+		m_UdpSendPacket.Clear();
+		m_UdpSendPacket << MessageHeader{ client->GetID(), code };
+		SendPacketToClientUdp(client, m_UdpSendPacket);
+	}
+	void SendPacketToClientUdp(Connection* client, const PacketWriter& packet);
+
+	// send the same message to every client in the room via tcp
+	// the message is only serialised once, however many clients there are
+	void BroadcastTcp(BroadcastMessage& message);
+	template<typename T>
+	void BroadcastMessageTcp(MessageCode code, const T& message)
+	{
+		BroadcastMessage broadcast{ code, message };
+		BroadcastTcp(broadcast);
+	}
+	void BroadcastMessageTcp(MessageCode code)
+	{
+		BroadcastMessage broadcast{ code };
+		BroadcastTcp(broadcast);
+	}
+
+	// get the next id in the queue
+	ProjectileID NextProjectileID();
+	BlockID NextBlockID();
+
+	bool VerifyProjecitleShoot(const sf::Vector2f& position, const PlayerStateFrame& player);
+	bool VerifyBlockPlacement(const sf::Vector2f& position, const PlayerStateFrame& player, PlayerTeam team);
+
+	bool OnTeamTurf(const sf::Vector2f& p, PlayerTeam team);
+
+	void CheckForBlocksAcrossTurfLine(float previousTurfLine);
+
+private:
+	// a message waiting in the inbox, along with the client it came from
+	struct InboxMessage
+	{
+		Connection* client;
+		UdpMessage* message;
+	};
+
+	unsigned int m_ID = 0;
+
+	// every room has its own queue of datagrams for the network thread, so sending needs no locking
+	NetworkIOThread& m_Network;
+	std::vector<InboxMessage> m_UdpInbox;
+
+	// reused for receiving and sending so that messages don't allocate
+	sf::Packet m_ReceivePacket;
+	PacketWriter m_UdpSendPacket;
+
+	// the clients in this room
+	std::vector<Connection*> m_Clients;
+	std::vector<Connection*> m_DepartedClients;
+
+	ProjectileID m_NextProjectileID = 0;
+	BlockID m_NextBlockID = 0;
+
+	// clock and timers
+	sf::Clock m_TickClock; // for timing simulation steps
+	float m_ServerTime = 0.0f; // real time, used for measuring latency
+	float m_SimulationTime = 0.0f; // advances in fixed steps of SIMULATION_TIMESTEP
+	float m_SimulationAccumulator = 0.0f;
+	float m_UpdateTimer = 0.0f;
+
+	SimulationStats m_SimulationStats;
+	SnapshotStats m_SnapshotStats;
+	TcpSendStats m_TcpStats;
+	// only ever used by the thread updating the room
+	PhaseProfiler m_Profiler;
+
+	// the most recent snapshots of every player, kept as baselines to delta-encode updates against
+	Snapshot m_Snapshots[SNAPSHOT_BUFFER_SIZE];
+	SnapshotSequence m_SnapshotSequence = NO_SNAPSHOT;
+	// each snapshot is only encoded once per baseline that clients have acknowledged, and once in full
+	// the encoded messages are indexed by baseline sequence (with the full snapshot last) and reused every update
+	std::vector<BroadcastMessage> m_SnapshotMessages;
+
+	// gameplay
+	unsigned int m_RedTeamPlayerCount = 0, m_BlueTeamPlayerCount = 0;
+
+	GameState m_GameState = GameState::Lobby;
+	float m_BuildModeDuration = INITIAL_BUILD_MODE_DURATION;
+	float m_FightModeDuration = INITIAL_FIGHT_MODE_DURATION;
+	float m_StateTimer = 0.0f;
+	float m_StateDuration = 0.0f;
+	int m_RoundNum = 0;
+
+	// turf line starts at halfway
+	float m_TurfLine = 0.5f * WORLD_WIDTH;
+
+	// objects simulated by the server
+	ProjectilePool m_Projectiles{ MAX_NUM_PROJECTILES };
+	BlockPool m_Blocks{ MAX_NUM_BLOCKS };
+
+	// objects destroyed during the current simulation step
+	ProjectilesDestroyedMessage m_DestroyedProjectiles;
+	BlocksDestroyedMessage m_DestroyedBlocks;
+
+	// spatial lookup of the blocks, kept in sync with m_Blocks
+	BlockGrid m_BlockGrid;
+	// reused between queries to avoid allocating
+	std::vector<ObjectHandle> m_BlockQueryResults;
+	WorldChunkMessage m_WorldChunk;
+
+	// broad phase for projectile/player collisions, rebuilt every simulation step
+	// bit p of a projectile's mask refers to m_PlayerBoundsClients[p]
+	PlayerBoundsBatch m_PlayerBounds;
+	Connection* m_PlayerBoundsClients[MAX_NUM_PLAYERS] = {};
+	std::vector<PlayerMask> m_ProjectilePlayerMasks;
+};
@@ -1,13 +1,36 @@
 #include "ServerApplication.h"
 #include "Log.h"
+#include "Trace.h"
+
+#include <csignal>
+
+
+static ServerApplication* s_ServerApp = nullptr;
+
+// ctrl+c lets the server finish its tick and shut down properly, rather than killing it mid-tick
+static void OnInterrupt(int)
+{
+	s_ServerApp->Quit();
+}
 
 int main()
 {
 	Log::Init();
+	TRACE_THREAD_NAME("Main");
 
 	ServerApplication* serverApp = new ServerApplication;
+	s_ServerApp = serverApp;
+	std::signal(SIGINT, OnInterrupt);
+	std::signal(SIGTERM, OnInterrupt);
+
 	serverApp->Run();
+
+	std::signal(SIGINT, SIG_DFL);
+	std::signal(SIGTERM, SIG_DFL);
 	delete serverApp;
 
+	LOG_INFO("Server shut down");
+	TRACE_FLUSH(SERVER_TRACE_FILE);
+
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,11 +1,29 @@
 #include "ServerApplication.h"
 
 #include "Log.h"
-#include "MathUtils.h"
 #include "Network/NetworkTypes.h"
 
+#include <string>
+#include <sstream>
+
+
+static unsigned int NumWorkerThreads()
+{
+	unsigned int threads = SERVER_WORKER_THREADS;
+	if (threads == 0)
+	{
+		// the main thread works on the rooms too
+		// hardware_concurrency can return 0 if it doesn't know
+		threads = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+	}
+
+	// there is never more than one thread's worth of work per room
+	return std::min(threads, MAX_NUM_ROOMS - 1);
+}
+
 
 ServerApplication::ServerApplication()
+	: m_Workers(NumWorkerThreads())
 {
 	// set up server
 
@@ -29,785 +47,416 @@ ServerApplication::ServerApplication()
 		LOG_ERROR("Server failed to listen on port {}", SERVER_PORT);
 	}
 	LOG_INFO("TCP: listening on port {}", SERVER_PORT);
+	LOG_INFO("Projectile kernels: {}", SimdLevelToStr(GetSimdLevel()));
+	LOG_INFO("Rooms: up to {0}, updated on {1} threads", MAX_NUM_ROOMS, m_Workers.NumThreads());
 	LOG_INFO("--------------");
 
+	// the main loop sleeps on these until there is data to read
+	// the udp socket belongs to the network thread
+	m_Selector.add(m_ListenSocket);
+
 	// setup client id queue
 	for (ClientID id = 0; id < INVALID_CLIENT_ID; id++)
 		m_NextClientID.push(id);
 
-	// set aside enough spaces in the vector for clients
-	m_Clients.reserve(MAX_NUM_PLAYERS);
+	// set aside enough spaces in the vectors for clients and rooms
+	m_Clients.reserve(INVALID_CLIENT_ID);
+	m_Rooms.reserve(MAX_NUM_ROOMS);
 
 	// create an empty (invalid) connection object
 	// to accept new clients with
 	m_NewConnection = new Connection;
 
-
-	// create the blocks around spawn
-	const int blockCount = 11;
-	for (int i = 0; i < blockCount; i++)
-	{
-		m_Blocks.push_back(new BlockState{ NextBlockID(), PlayerTeam::None, { SPAWN_WIDTH - 0.5f * BLOCK_SIZE,				 0.5f * WORLD_HEIGHT - (BLOCK_SIZE * (blockCount / 2)) + BLOCK_SIZE * i } });
-		m_Blocks.push_back(new BlockState{ NextBlockID(), PlayerTeam::None, { WORLD_WIDTH - SPAWN_WIDTH + 0.5f * BLOCK_SIZE, 0.5f * WORLD_HEIGHT - (BLOCK_SIZE * (blockCount / 2)) + BLOCK_SIZE * i } });
-	}
-
+	// there is always at least one room to join
+	m_Rooms.push_back(new Room(0, m_Network));
 }
 
 ServerApplication::~ServerApplication()
 {
 	// clean up
 
-	// delete all objects in the game world
-	for (auto projectile : m_Projectiles)
-		delete projectile;
-	for (auto block : m_Blocks)
-		delete block;
-
 	delete m_NewConnection;
 	// disconnect all clients
 	for (auto client : m_Clients)
 		delete client;
+	for (auto room : m_Rooms)
+		delete room;
 }
 
 void ServerApplication::Run()
 {
 	m_ServerClock.restart();
+	// from here on the udp socket is only touched by the network thread
+	m_Network.Start();
 
-	while (true)
+	while (!m_Quit)
 	{
-		// update simulation time,
-		// calculate dt
-		float lastSimTime = m_SimulationTime;
-		m_SimulationTime = m_ServerClock.getElapsedTime().asMilliseconds() / 1000.0f;
-		float dt = m_SimulationTime - lastSimTime;
+		// sleep until a socket has data to read or the next timer is due
+		// rather than spinning on non-blocking sockets
+		float timeout = TimeUntilNextEvent();
+		m_Selector.wait(sf::seconds(std::max(timeout, MIN_SELECTOR_TIMEOUT)));
 
-		// update game objects and game state
-		SimulateGameObjects(dt);
-		UpdateGameState(dt);
+		// calculate how much real time has passed since the last iteration
+		// network timers run off of real time, the simulation runs off of fixed steps
+		float lastServerTime = m_ServerTime;
+		m_ServerTime = m_ServerClock.getElapsedTime().asSeconds();
+		float dt = m_ServerTime - lastServerTime;
 
-		// listen for new connections
-		if (m_ListenSocket.accept(m_NewConnection->GetSocket()) == sf::Socket::Done)
-		{
-			// new connection found
-			// setup connection
+		// time everything the tick does, but not the time spent asleep
+		sf::Int64 tickBegin = m_Profiler.Begin();
 
-			// check we don't have too many clients connected
-			if (m_Clients.size() < MAX_NUM_PLAYERS)
-			{
-				ProcessConnect();
-			}
-			else
-			{
-				// reject this clients connection
-				// this will send invalid client id back to the new client
-				m_NewConnection->SendMessageTcp(MessageCode::Connect);
-				m_NewConnection->GetSocket().disconnect();
-			}
-		}
-
-		for (auto client : m_Clients)
+		// listen for new connections
+		if (m_Selector.isReady(m_ListenSocket))
 		{
-			// increment idle timer
-			client->IncreaseIdleTimer(dt);
+			ProfileScope scope{ m_Profiler, ServerPhase::Accept };
 
-			// try to recieve data
-			sf::Packet packet;
-			sf::Socket::Status status = client->GetSocket().receive(packet);
-			if (status == sf::Socket::Done)
+			while (m_ListenSocket.accept(m_NewConnection->GetSocket()) == sf::Socket::Done)
 			{
-				// data was recieved
-				MessageHeader header;
-				packet >> header;
+				// new connection found
+				// setup connection
 
-				// call appropriate callback
-				switch (header.messageCode)
+				// check we don't have too many clients connected
+				Room* room = m_NextClientID.empty() ? nullptr : FindRoomForNewClient();
+				if (room)
 				{
-				case MessageCode::Introduction:			ProcessIntroduction(client, packet);	break;
-				case MessageCode::Disconnect:			ProcessDisconnect(client);				break;
-				case MessageCode::ChangeTeam:			ProcessChangeTeam(client);				break;
-				case MessageCode::GetServerTime:		ProcessGetServerTime(client);			break;
-				case MessageCode::Shoot:				ProcessShootRequest(client, packet);	break;
-				case MessageCode::Place:				ProcessPlaceRequest(client, packet);	break;
-				case MessageCode::GameStart:			ProcessGameStartRequest(client);		break;
-					// these messages are sent from the server to clients, so it would be incorrect for the server to recieve them
-				case MessageCode::Connect:
-				case MessageCode::PlayerConnected:
-				case MessageCode::PlayerDisconnected:
-				case MessageCode::ShootRequestDenied:
-				case MessageCode::PlaceRequestDenied:
-				case MessageCode::PlayerDeath:
-				case MessageCode::ProjectilesDestroyed:
-				case MessageCode::BlocksDestroyed:
-				case MessageCode::ChangeGameState:
-				case MessageCode::TurfLineMoved:
-														LOG_WARN("Received invalid message code"); break;
-				case MessageCode::Update:						  
-				case MessageCode::Ping:
-														LOG_WARN("Received update message via TCP; updates should be sent via UDP"); break;
-
-				default:								LOG_WARN("Unknown message code: {}", static_cast<int>(header.messageCode)); break;
-
+					ProcessConnect(room);
 				}
-
-				// reset idle timer
-				client->ResetIdleTimer();
-			}
-			else if (status == sf::Socket::Error)
-			{
-				LOG_ERROR("Error occurred while receiving messages");
-			}
-			else if (status == sf::Socket::Disconnected)
-			{
-				LOG_WARN("Client {0} unexpectedly disconnected! Cleaning up...", client->GetID());
-				// clean up; disconnect the client
-				ProcessDisconnect(client);
-			}
-
-
-			// query idle timer
-			if (client->GetIdleTimer() > IDLE_TIMEOUT)
-			{
-				// disconnect this client for being idle
-				LOG_INFO("Client {0} timed out, disconnecting...", client->GetID());
-				ProcessDisconnect(client);
-			}
-
-		}
-
-		// listen for incoming UDP data
-		sf::Packet packet;
-		sf::IpAddress fromAddr;
-		unsigned short fromPort;
-		auto status = m_UdpSocket.receive(packet, fromAddr, fromPort);
-		if (status == sf::Socket::Done)
-		{
-			// data was recieved
-			MessageHeader header;
-			packet >> header;
-
-			// its possible the client has been disconnected between sending an update and the server receiving it
-			// so the client may no longer exist
-			Connection* client = FindClientWithID(header.clientID);
-			if (client)
-			{
-				// call appropriate callback
-				switch (header.messageCode)
+				else
 				{
-				case MessageCode::Update:	ProcessUpdate(client, packet); break;
-				case MessageCode::Ping:		client->CalculateLatency(m_SimulationTime); break;
-				default:					LOG_WARN("Received unexpected message code"); break;
+					// reject this clients connection
+					// this will send invalid client id back to the new client
+					m_NewConnection->SendMessageTcp(MessageCode::Connect);
+					m_NewConnection->FlushTcp();
+					m_NewConnection->GetSocket().disconnect();
+					m_NewConnection->DiscardQueuedTcp();
 				}
-
-				// also reset idle timer when any udp data is received
-				client->ResetIdleTimer();
 			}
 		}
-		else if (status == sf::Socket::Error)
-		{
-			LOG_ERROR("Error occurred while attempting to receive messages");
-		}
 
-		// update timer - sending out regular updates to all clients
-		m_UpdateTimer += dt;
-		if (m_UpdateTimer > UPDATE_FREQUENCY)
+		// take the UDP data the network thread has received, and sort it into the rooms it is for
 		{
-			// create a packet containing all update data
-			std::vector<UpdateMessage> allUpdateData(m_Clients.size());
-
-			// populate the update vector
-			int i = 0;
-			for (auto& client : m_Clients)
-			{
-				if (client->StateQueueEmpty()) continue;
-
-				PlayerStateFrame& ps = client->GetCurrentPlayerState();
-				allUpdateData[i] =
-				{
-					client->GetID(),
-					ps.position.x,
-					ps.position.y, 
-					ps.rotation,
-					ps.dt,
-					ps.sendTimestamp
-				};
-				i++;
-			}
-
-			for (auto& client : m_Clients)
-			{
-				// construct an update message from the update data vector
-				MessageHeader header{ client->GetID(), MessageCode::Update };
-				sf::Packet packet;
-				packet << header;
-				for (auto& updateMessage : allUpdateData) packet << updateMessage;
-			
-				// send it to the client
-				auto status = m_UdpSocket.send(packet, client->GetIP(), client->GetUdpPort());
-				if (status != sf::Socket::Done)
-					LOG_ERROR("Failed to send udp packet to client ID: {}", client->GetID());
-			}
-
-			m_UpdateTimer -= UPDATE_FREQUENCY;
+			ProfileScope scope{ m_Profiler, ServerPhase::UdpRoute };
+			RouteUdpBatch();
 		}
 
-		// ping clients to measure latency frequently
-		m_PingTimer += dt;
-		if (m_PingTimer > PING_FREQUENCY)
+		// every room simulates, services its clients and sends them their updates independently of the others,
+		// so they are all updated at the same time
+		// the selector, sockets and client list aren't touched by anything else until every room has finished
 		{
-			// send a ping to all clients
-			for (auto client : m_Clients)
+			ProfileScope scope{ m_Profiler, ServerPhase::Rooms };
+			m_Workers.Run(m_Rooms.size(), [this, dt](size_t i)
 			{
-				client->BeginPing(m_SimulationTime);
-				SendMessageToClientUdp(client, MessageCode::Ping);
-			}
-			m_PingTimer -= PING_FREQUENCY;
+				m_Rooms[i]->Update(dt, m_ServerTime, m_Selector);
+			});
 		}
-	}
-}
-
 
-void ServerApplication::SimulateGameObjects(float dt)
-{
-	bool gameOver = false;
+		// the rooms are finished with the datagrams, hand their slots back to the network thread
+		m_Network.GetInbound().Pop(m_UdpBatchSize);
 
-	// simulate projectiles
-	for (auto proj_it = m_Projectiles.begin(); proj_it != m_Projectiles.end();)
-	{
-		auto projectile = *proj_it;
-
-		// update position
-		projectile->SimulationStep(dt);
-
-		// check if the projectile has hit a block
-		bool hitBlock = false;
-		for (auto block_it = m_Blocks.begin(); block_it != m_Blocks.end(); block_it++)
 		{
-			auto block = *block_it;
-
-			if (projectile->BlockCollision(block))
-			{
-				hitBlock = true;
-
-				// destroy the block
-				if (block->team != projectile->team && block->team != PlayerTeam::None)
-				{
-					DestroyBlock(block);
-					m_Blocks.erase(block_it);
-				}
+			ProfileScope scope{ m_Profiler, ServerPhase::Cleanup };
+			for (auto room : m_Rooms)
+				RemoveDepartedClients(room);
 
-				break;
-			}
+			// every room has flushed, so this is how many clients are behind right now
+			unsigned int backloggedClients = 0;
+			for (auto client : m_Clients)
+				if (client->IsSendBacklogged()) backloggedClients++;
+			m_PeakBackloggedClients = std::max(m_PeakBackloggedClients, backloggedClients);
 		}
 
-		// check if this projectile has hit a player
-		bool hitPlayer = false;
-
-		// perform projectile collision calculations in the time frame of the player that shot the projectile
-		
-		// how much in the future the client that shot the projectile sees the projectile
-		float timeDifference = projectile->serverShootTime - projectile->clientShootTime;
-		// work out where the projectile will be at the current time plus the time difference
-		sf::Vector2f projPos = projectile->PositionAtServerTime(m_SimulationTime + timeDifference);
-
-		for (auto client : m_Clients)
-		{
-			if (client->GetPlayerTeam() == projectile->team) continue;
-
-			// check for collision with the player
-			if (projectile->PlayerCollision(client->GetCurrentPlayerState().position))
-			{
-				hitPlayer = true;
-
-				// kill player
-				client->SendMessageTcp(MessageCode::PlayerDeath);
-
-				// move turf line
-				m_TurfLine += m_RoundNum * BLOCK_SIZE * (projectile->team == PlayerTeam::Red ? 1 : - 1);
-				// check win condition
-				if (m_TurfLine <= SPAWN_WIDTH || m_TurfLine >= WORLD_WIDTH - SPAWN_WIDTH)
-				{
-					EndGame();
-					gameOver = true;
-				}
-
-				// transmit turf move to all players
-				for (auto c2 : m_Clients)
-				{
-					TurfLineMoveMessage message{ m_TurfLine };
-					c2->SendMessageTcp(MessageCode::TurfLineMoved, message);
-				}
-
-				// moving the turf line may destroy a bunch of blocks
-				CheckForBlocksAcrossTurfLine();
-
-				break;
-			}
-		}
-		if (gameOver) break;
+		m_Profiler.End(ServerPhase::Tick, tickBegin);
 
-		// check if anything happened that should destroy the projectile
-		if (hitBlock || hitPlayer || projectile->position.x - PROJECTILE_RADIUS < 0 || projectile->position.x + PROJECTILE_RADIUS > WORLD_WIDTH
-								  || projectile->position.y - PROJECTILE_RADIUS < 0 || projectile->position.y + PROJECTILE_RADIUS > WORLD_HEIGHT)
-		{
-			DestroyProjectile(projectile);
-			proj_it = m_Projectiles.erase(proj_it);
-		}
-		else
-			proj_it++;
+		ReportStats(dt);
 	}
 }
 
-void ServerApplication::UpdateGameState(float dt)
+
+float ServerApplication::TimeUntilNextEvent() const
 {
-	// nothing to update in the lobby
-	if (m_GameState == GameState::Lobby) return;
+	// wake up for whichever room next has work to do
+	float timeout = SERVER_STATS_FREQUENCY - m_StatsTimer;
+	for (auto room : m_Rooms)
+		timeout = std::min(timeout, room->TimeUntilNextEvent());
 
-	// increment state timer
-	m_StateTimer += dt;
+	return timeout;
+}
 
-	if (m_StateTimer > m_StateDuration)
+void ServerApplication::RouteUdpBatch()
+{
+	// take up to a batch of datagrams from the front of the queue
+	// they stay in the queue until the rooms have processed them, so nothing is copied
+	SpscRing<UdpMessage>& inbound = m_Network.GetInbound();
+	size_t available = inbound.Available();
+	m_UdpBatchSize = std::min(available, static_cast<size_t>(MAX_UDP_DATAGRAMS_PER_TICK));
+
+	// if the batch filled up there is still data waiting; it will be picked up next tick
+	if (available > m_UdpBatchSize)
+		m_UdpStats.fullBatches++;
+
+	m_UdpStats.lastTickDatagrams = static_cast<unsigned int>(m_UdpBatchSize);
+	m_UdpStats.peakTickDatagrams = std::max(m_UdpStats.peakTickDatagrams, m_UdpStats.lastTickDatagrams);
+	m_UdpStats.totalDatagrams += m_UdpStats.lastTickDatagrams;
+	m_UdpStats.ticks++;
+
+	for (size_t i = 0; i < m_UdpBatchSize; i++)
 	{
-		// switch state!
-		m_StateTimer = 0.0f;
-
-		switch (m_GameState)
+		// the network thread has already decoded the message, and thrown away anything malformed
+		UdpMessage& message = inbound.Peek(i);
+		const MessageHeader& header = message.header;
+
+		// its possible the client has been disconnected between sending an update and the server receiving it
+		// so the client may no longer exist
+		Connection* client = FindClientWithID(header.clientID);
+		if (!client)
 		{
-		case GameState::Lobby: break;
-		case GameState::FightMode:
-			// configure for build mode
-			m_GameState = GameState::BuildMode;
-			m_StateDuration = m_BuildModeDuration;
-			m_FightModeDuration = std::max(m_FightModeDuration - 10.0f, MIN_FIGHT_MODE_DURATION);
-
-			break;
-		case GameState::BuildMode:	
-			// configure for fight mode
-			m_GameState = GameState::FightMode;
-			m_StateDuration = m_FightModeDuration;
-			m_BuildModeDuration = std::max(m_BuildModeDuration - 10.0f, MIN_BUILD_MODE_DURATION);
-			m_RoundNum++;
-
-			break;
-		default:
-			LOG_ERROR("Unknown game state"); break;
+			m_UdpStats.droppedDatagrams++;
+			continue;
 		}
 
-		// kill all projectiles
-		for (auto projectile : m_Projectiles)
-			delete projectile;
-		m_Projectiles.clear();
-
-		// tell all clients
-		for (auto client : m_Clients)
+		// the id in the header is only a claim, make sure it came from where that client is connected from
+		if (!client->IsUdpSource(message.address, message.port))
 		{
-			ChangeGameStateMessage message{ m_GameState, m_StateDuration };
-			client->SendMessageTcp(MessageCode::ChangeGameState, message);
+			m_UdpStats.droppedDatagrams++;
+			m_UdpStats.spoofedDatagrams++;
+			continue;
 		}
-	}
-
-}
-
-void ServerApplication::StartGame()
-{
-	// set up initial game state
-	m_GameState = GameState::BuildMode;
-	m_StateDuration = INITIAL_BUILD_MODE_DURATION;
-	m_RoundNum = 0;
 
-	m_BuildModeDuration = INITIAL_BUILD_MODE_DURATION;
-	m_FightModeDuration = INITIAL_FIGHT_MODE_DURATION;
-
-	// reset turf line
-	m_TurfLine = 0.5f * WORLD_WIDTH;
-
-	// tell all clients the game has started
-	for (auto client : m_Clients)
-	{
-		client->SendMessageTcp(MessageCode::GameStart);
-		// reset ready flag
-		client->SetReady(false);
+		// the room processes it when it is next updated
+		m_RoomsByClientID[header.clientID]->QueueMessage(client, message);
 	}
 }
 
-void ServerApplication::EndGame()
+void ServerApplication::ReportStats(float dt)
 {
-	// reset game state
-	// send game back to the lobby
-	m_GameState = GameState::Lobby;
-	m_StateDuration = 0.0f;
-	m_StateTimer = 0.0f;
-	m_RoundNum = 0;
-
-	for (auto client : m_Clients)
+	m_StatsTimer += dt;
+	if (m_StatsTimer < SERVER_STATS_FREQUENCY) return;
+	m_StatsTimer -= SERVER_STATS_FREQUENCY;
+
+	NetworkIOStats networkStats = m_Network.TakeStats();
+
+	// add up what every room has been doing
+	SimulationStats simulationStats;
+	TcpSendStats tcpStats;
+	SnapshotStats snapshotStats;
+	// the main loop's phases, and every room's phases added together
+	m_ReportProfiler = m_Profiler;
+	size_t activeRooms = 0;
+	for (auto room : m_Rooms)
 	{
-		// tell all clients the game has ended
-		ChangeGameStateMessage message{ m_GameState, m_StateDuration };
-		client->SendMessageTcp(MessageCode::ChangeGameState, message);
-		// reset ready flag
-		client->SetReady(false);
-	}
+		simulationStats.Add(room->GetSimulationStats());
+		tcpStats.Add(room->GetTcpStats());
+		snapshotStats.Add(room->GetSnapshotStats());
+		m_ReportProfiler.Add(room->GetProfiler());
+		room->ResetStats();
 
-	// kill all projectiles
-	for (auto projectile : m_Projectiles)
-		delete projectile;
-	m_Projectiles.clear();
-	// kill all blocks placed by players
-	for (auto it = m_Blocks.begin(); it != m_Blocks.end();)
-	{
-		if ((*it)->team != PlayerTeam::None)
-		{
-			delete (*it);
-			it = m_Blocks.erase(it);
-		}
-		else it++;
+		if (room->NumClients() > 0) activeRooms++;
 	}
-}
-
-void ServerApplication::DestroyProjectile(ProjectileState* projectile)
-{
-	// tell all clients that this projectile has been destroyed
-	ProjectilesDestroyedMessage message;
-	message.count = 1;
-	message.ids[0] = projectile->id;
 
-	for (auto client : m_Clients)
-		client->SendMessageTcp(MessageCode::ProjectilesDestroyed, message);
-}
-
-void ServerApplication::DestroyBlock(BlockState* block)
-{
-	// tell all clients that this block has been destroyed
-	BlocksDestroyedMessage message;
-	message.count = 1;
-	message.ids[0] = block->id;
-
-	for (auto client : m_Clients)
-		client->SendMessageTcp(MessageCode::BlocksDestroyed, message);
-}
-
-void ServerApplication::ProcessConnect()
-{
-	// a new client has connected
-	// get an ID for them
-	ClientID newClientID = NextClientID();
-	// calculate their player number
-	sf::Uint8 playerNumber = static_cast<sf::Uint8>(m_Clients.size() + 1);
-
-	// setup connection object
-	m_NewConnection->OnTcpConnected(newClientID, playerNumber);
-
-	// tell the client their ID
-	ConnectMessage connectMessage;
-	connectMessage.playerNumber = playerNumber;
-
-	// assign their team
-	if (m_RedTeamPlayerCount < m_BlueTeamPlayerCount)
-	{
-		m_NewConnection->SetPlayerTeam(PlayerTeam::Red);
-		m_RedTeamPlayerCount++;
-	}
-	else
+	// only worth reporting while there is someone to receive from
+	if (!m_Clients.empty())
 	{
-		m_NewConnection->SetPlayerTeam(PlayerTeam::Blue);
-		m_BlueTeamPlayerCount++;
+		LOG_INFO("[Rooms] {0} players in {1} rooms ({2} open), {3} threads",
+			m_Clients.size(), activeRooms, m_Rooms.size(), m_Workers.NumThreads());
+
+		float averagePerTick = m_UdpStats.ticks > 0 ? static_cast<float>(m_UdpStats.totalDatagrams) / m_UdpStats.ticks : 0.0f;
+		LOG_INFO("[UDP] {0} datagrams in {1:.0f}s, avg/tick: {2:.2f}, peak/tick: {3}, dropped: {4} ({5} spoofed), full batches: {6}",
+			m_UdpStats.totalDatagrams, SERVER_STATS_FREQUENCY, averagePerTick, m_UdpStats.peakTickDatagrams, m_UdpStats.droppedDatagrams, m_UdpStats.spoofedDatagrams, m_UdpStats.fullBatches);
+		LOG_INFO("[Network thread] received: {0}, sent: {1}, malformed: {2}, dropped in: {3}, dropped out: {4}, receive errors: {5}, send errors: {6}",
+			networkStats.received, networkStats.sent, networkStats.malformed, networkStats.inboundDrops, networkStats.outboundDrops, networkStats.receiveErrors, networkStats.sendErrors);
+
+		float averageTickTime = simulationStats.ticks > 0 ? simulationStats.totalTickTime / simulationStats.ticks : 0.0f;
+		LOG_INFO("[Simulation] {0} ticks at {1:.0f}Hz, avg: {2:.3f}ms, max: {3:.3f}ms, overruns: {4}, dropped steps: {5}",
+			simulationStats.ticks, SIMULATION_TICK_RATE, 1000.0f * averageTickTime, 1000.0f * simulationStats.maxTickTime, simulationStats.overruns, simulationStats.droppedSteps);
 	}
-	connectMessage.team = m_NewConnection->GetPlayerTeam();
 
-	// tell them about the current world state
-	connectMessage.numPlayers = static_cast<sf::Uint8>(m_Clients.size());
-	for (size_t i = 0; i < m_Clients.size(); i++)
+	if (!m_Clients.empty() && tcpStats.flushes > 0)
 	{
-		connectMessage.playerIDs[i] = m_Clients[i]->GetID();
-
-		connectMessage.playerTeams[i] = m_Clients[i]->GetPlayerTeam();
+		LOG_INFO("[TCP] {0} messages in {1} sends, avg messages/send: {2:.2f}, avg send size: {3:.1f} bytes",
+			tcpStats.messages, tcpStats.flushes, static_cast<float>(tcpStats.messages) / tcpStats.flushes, static_cast<float>(tcpStats.totalBytes) / tcpStats.flushes);
+		LOG_INFO("[TCP] partial sends: {0}, peak queued: {1} bytes, peak backlogged clients: {2}, dropped for falling behind: {3}",
+			tcpStats.partialFlushes, tcpStats.peakQueuedBytes, m_PeakBackloggedClients, tcpStats.overflowDisconnects);
 	}
-	connectMessage.numBlocks = static_cast<sf::Uint8>(m_Blocks.size());
-	for (size_t i = 0; i < m_Blocks.size(); i++)
-	{
-		connectMessage.blockIDs[i] = m_Blocks[i]->id;
-		connectMessage.blockTeams[i] = m_Blocks[i]->team;
-		connectMessage.blockXs[i] = m_Blocks[i]->position.x;
-		connectMessage.blockYs[i] = m_Blocks[i]->position.y;
-	}
-	connectMessage.gameState = m_GameState;
-	connectMessage.remainingStateDuration = m_StateDuration - m_StateTimer;
-	connectMessage.turfLine = m_TurfLine;
-
-	// send the world state to the client
-	m_NewConnection->SendMessageTcp(MessageCode::Connect, connectMessage);
 
-	// tell all other clients a new player has connected
-	for (auto& c : m_Clients)
+	if (!m_Clients.empty() && snapshotStats.messages > 0)
 	{
-		PlayerConnectedMessage playerConnectedMessage{ newClientID, m_NewConnection->GetPlayerTeam() };
-		c->SendMessageTcp(MessageCode::PlayerConnected, playerConnectedMessage);
+		LOG_INFO("[Snapshots] {0} taken, {1} sent ({2} delta), avg size: {3:.1f} bytes",
+			snapshotStats.snapshots, snapshotStats.messages, snapshotStats.deltaMessages, static_cast<float>(snapshotStats.totalBytes) / snapshotStats.messages);
 	}
 
-	// add to collection of clients
-	m_Clients.push_back(m_NewConnection);
-	LOG_INFO("[Player Joined] Player: {0} ID: {1} IP: {2} ", m_NewConnection->GetPlayerNumber(), newClientID, m_NewConnection->GetSocket().getRemoteAddress().toString());
-
-	// create a new blank connection object
-	m_NewConnection = new Connection;
-}
-
-void ServerApplication::ProcessIntroduction(Connection* client, sf::Packet& packet)
-{
-	IntroductionMessage introductionMessage;
-	packet >> introductionMessage;
-	client->SetUdpPort(introductionMessage.udpPort);
-}
-
-
-
-void ServerApplication::ProcessDisconnect(Connection* client)
-{
-	// acknowledge the clients requests to disconnect
-	client->SendMessageTcp(MessageCode::Disconnect);
-
-	// allow thier id to be reused later
-	m_NextClientID.push(client->GetID());
-	if (client->GetPlayerTeam() == PlayerTeam::Red)
-		m_RedTeamPlayerCount--;
-	else
-		m_BlueTeamPlayerCount--;
-
-	// remove client from vector
-	auto it = m_Clients.begin();
-	for (; it != m_Clients.end(); it++)
+	if (!m_Clients.empty())
 	{
-		if (*it == client) break;
+		LogConnectionStats();
+		m_ReportProfiler.LogSummary();
 	}
-	m_Clients.erase(it);
 
-	// tell all other players a player disconnected
-	for (auto& c : m_Clients)
+	// the stats file is always written, so that tools can tell the server is alive even when it is empty
+	if (SERVER_STATS_FILE[0] != '\0')
 	{
-		PlayerDisconnectedMessage playerDisconnectedMessage{ client->GetID() };
-		c->SendMessageTcp(MessageCode::PlayerDisconnected, playerDisconnectedMessage);
+		std::ostringstream extra;
+		extra << "\t\"players\": " << m_Clients.size()
+			<< ",\n\t\"rooms\": " << m_Rooms.size()
+			<< ",\n\t\"active_rooms\": " << activeRooms
+			<< ",\n\t\"threads\": " << m_Workers.NumThreads()
+			<< ",\n";
+		WriteConnectionStatsJson(extra);
+
+		if (!m_ReportProfiler.WriteJson(SERVER_STATS_FILE, SERVER_STATS_FREQUENCY, extra.str()))
+			LOG_WARN("Failed to write stats to {}", SERVER_STATS_FILE);
 	}
 
-	// finally delete the client
-	LOG_INFO("Player ID {} disconnected", client->GetID());
-	delete client;
+	// start a new reporting window
+	m_UdpStats = UdpIngestStats{};
+	m_PeakBackloggedClients = 0;
+	m_Profiler.Reset();
+	for (auto client : m_Clients)
+		client->GetStats().ResetCounters();
 }
 
-void ServerApplication::ProcessUpdate(Connection* client, sf::Packet& packet)
+void ServerApplication::LogConnectionStats() const
 {
-	// unpack packet
-	UpdateMessage updateMessage;
-	packet >> updateMessage;
+	// averages and worst cases across every client
+	float totalRtt = 0.0f, maxRtt = 0.0f;
+	float totalJitter = 0.0f, maxJitter = 0.0f;
+	unsigned int received = 0, lost = 0, outOfOrder = 0, late = 0, pingsLost = 0;
+	size_t bytesIn = 0, bytesOut = 0;
 
-	if (updateMessage.playerID != client->GetID())
-	{
-		// just in case this manages to happen?
-		LOG_WARN("Client sending update data with incorrect client ID");
-		return;
-	}
-
-	client->AddToStateQueue(updateMessage);
-}
-
-void ServerApplication::ProcessChangeTeam(Connection* client)
-{
-	// decide if the player is allowed to change team
-	// for now always allow
-	
-	// switch team
-	if (client->GetPlayerTeam() == PlayerTeam::Red)
-	{
-		client->SetPlayerTeam(PlayerTeam::Blue);
-		m_RedTeamPlayerCount--;
-		m_BlueTeamPlayerCount++;
-	}
-	else
+	for (auto client : m_Clients)
 	{
-		client->SetPlayerTeam(PlayerTeam::Red);
-		m_RedTeamPlayerCount++;
-		m_BlueTeamPlayerCount--;
+		const ConnectionStats& stats = client->GetStats();
+		totalRtt += stats.GetFilteredRtt();
+		maxRtt = std::max(maxRtt, stats.GetFilteredRtt());
+		totalJitter += stats.GetJitter();
+		maxJitter = std::max(maxJitter, stats.GetJitter());
+		received += stats.GetSequencedReceived();
+		lost += stats.GetSequencedLost();
+		outOfOrder += stats.GetOutOfOrder();
+		late += stats.GetLate();
+		pingsLost += stats.GetPingsLost();
+		bytesIn += stats.GetTotalReceived().bytes;
+		bytesOut += stats.GetTotalSent().bytes;
 	}
 
-	ChangeTeamMessage changeTeamMessage{ client->GetID(), client->GetPlayerTeam() };
-
-	// transmit this change to all clients
-	for (auto c : m_Clients)
-		c->SendMessageTcp(MessageCode::ChangeTeam, changeTeamMessage);
+	float numClients = static_cast<float>(m_Clients.size());
+	float lossRate = (received + lost) > 0 ? static_cast<float>(lost) / (received + lost) : 0.0f;
+	LOG_INFO("[Connections] rtt avg: {0:.1f}ms, max: {1:.1f}ms, jitter avg: {2:.1f}ms, max: {3:.1f}ms",
+		1000.0f * totalRtt / numClients, 1000.0f * maxRtt, 1000.0f * totalJitter / numClients, 1000.0f * maxJitter);
+	LOG_INFO("[Connections] in: {0:.1f}KB/s, out: {1:.1f}KB/s, update loss: {2:.2f}%, out of order: {3}, late: {4}, pings lost: {5}",
+		bytesIn / (1024.0f * SERVER_STATS_FREQUENCY), bytesOut / (1024.0f * SERVER_STATS_FREQUENCY), 100.0f * lossRate, outOfOrder, late, pingsLost);
 }
 
-void ServerApplication::ProcessGetServerTime(Connection* client)
+void ServerApplication::WriteConnectionStatsJson(std::ostream& out) const
 {
-	ServerTimeMessage response{ m_SimulationTime };
-	client->SendMessageTcp(MessageCode::GetServerTime, response);
-}
+	out.setf(std::ios::fixed);
+	out.precision(3);
 
-void ServerApplication::ProcessShootRequest(Connection* client, sf::Packet& packet)
-{
-	ShootMessage shootMessage;
-	packet >> shootMessage;
-
-	// check if the projectile can be spawned
-	if (VerifyProjecitleShoot({ shootMessage.x, shootMessage.y }, client->GetCurrentPlayerState()))
+	out << "\t\"connections\": [";
+	for (size_t i = 0; i < m_Clients.size(); i++)
 	{
-		// create new projectile object
-		shootMessage.id = NextProjectileID();
-
-		ProjectileState* newProjectile = new ProjectileState(shootMessage);
-		newProjectile->serverShootTime = m_SimulationTime;
-		newProjectile->clientShootTime = m_SimulationTime - client->GetLatency();
-		m_Projectiles.push_back(newProjectile);
+		const Connection* client = m_Clients[i];
+		const ConnectionStats& stats = client->GetStats();
+
+		out << (i == 0 ? "\n" : ",\n");
+		out << "\t\t{ \"id\": " << static_cast<int>(client->GetID())
+			<< ", \"room\": " << m_RoomsByClientID[client->GetID()]->GetID()
+			<< ", \"rtt_ms\": " << 1000.0f * stats.GetLastRtt()
+			<< ", \"srtt_ms\": " << 1000.0f * stats.GetSmoothedRtt()
+			<< ", \"rttvar_ms\": " << 1000.0f * stats.GetRttVariance()
+			<< ", \"filtered_rtt_ms\": " << 1000.0f * stats.GetFilteredRtt()
+			<< ", \"jitter_ms\": " << 1000.0f * stats.GetJitter()
+			<< ", \"update_loss\": " << stats.GetLossRate()
+			<< ", \"out_of_order\": " << stats.GetOutOfOrder()
+			<< ", \"late\": " << stats.GetLate()
+			<< ", \"duplicates\": " << stats.GetDuplicates()
+			<< ", \"pings_lost\": " << stats.GetPingsLost()
+			<< ", \"packets_in\": " << stats.GetTotalReceived().packets
+			<< ", \"bytes_in\": " << stats.GetTotalReceived().bytes
+			<< ", \"packets_out\": " << stats.GetTotalSent().packets
+			<< ", \"bytes_out\": " << stats.GetTotalSent().bytes
+			<< ",\n\t\t\t\"messages\": {";
+
+		// only the message codes that were used
+		bool first = true;
+		for (size_t c = 0; c < NUM_MESSAGE_CODES; c++)
+		{
+			MessageCode code = static_cast<MessageCode>(c);
+			const MessageTraffic& in = stats.GetReceived(code);
+			const MessageTraffic& sent = stats.GetSent(code);
+			if (in.packets == 0 && sent.packets == 0) continue;
 
-		// tell all clients a projectile has been shot
-		for (auto c : m_Clients)
-			c->SendMessageTcp(MessageCode::Shoot, shootMessage);
-	}
-	else
-	{
-		// tell the player their request has been denied
-		client->SendMessageTcp(MessageCode::ShootRequestDenied);
+			out << (first ? " " : ", ") << "\"" << MessageCodeToStr(code) << "\": [" << in.packets << ", " << in.bytes << ", " << sent.packets << ", " << sent.bytes << "]";
+			first = false;
+		}
+		out << " } }";
 	}
+	out << "\n\t]";
 }
 
-void ServerApplication::ProcessPlaceRequest(Connection* client, sf::Packet& packet)
+void ServerApplication::ProcessConnect(Room* room)
 {
-	PlaceMessage placeMessage;
-	packet >> placeMessage;
-
-	// check if block can be placed
-	if (VerifyBlockPlacement({ placeMessage.x, placeMessage.y }, client->GetCurrentPlayerState(), client->GetPlayerTeam()))
-	{
-		// create new block
-		placeMessage.id = NextBlockID();
-		
-		BlockState* newBlock = new BlockState(placeMessage);
-		m_Blocks.push_back(newBlock);
-
-		for (auto c : m_Clients)
-			c->SendMessageTcp(MessageCode::Place, placeMessage);
-	}
-	else
-	{
-		// tell the player their block place request has been rejected
-		client->SendMessageTcp(MessageCode::PlaceRequestDenied);
-	}
-}
+	// a new client has connected
+	// get an ID for them
+	ClientID newClientID = NextClientID();
 
-void ServerApplication::ProcessGameStartRequest(Connection* client)
-{
-	if (m_GameState != GameState::Lobby)
-	{
-		LOG_WARN("Cannot request game to start outside of lobby state!");
-		return;
-	}
+	// setup connection object
+	m_NewConnection->OnTcpConnected(newClientID);
 
-	client->SetReady(true);
+	// add to collection of clients
+	m_Clients.push_back(m_NewConnection);
+	m_ClientsByID[newClientID] = m_NewConnection;
+	m_RoomsByClientID[newClientID] = room;
+	m_Selector.add(m_NewConnection->GetSocket());
 
-	// if all clients are ready then start the game
-	bool allReady = true;
-	for (auto c : m_Clients)
-		allReady &= c->IsReady();
+	// the room tells them (and everyone else in it) about the match they have joined
+	room->AddClient(m_NewConnection);
 
-	if (allReady)
-		StartGame();
+	// create a new blank connection object
+	m_NewConnection = new Connection;
 }
 
-
-Connection* ServerApplication::FindClientWithID(ClientID id)
+Room* ServerApplication::FindRoomForNewClient()
 {
-	for (auto& connection : m_Clients)
+	// fill up the rooms that are already open before opening another
+	for (auto room : m_Rooms)
 	{
-		if (connection->GetID() == id) return connection;
+		if (!room->IsFull()) return room;
 	}
-	return nullptr;
-}
-
-ClientID ServerApplication::NextClientID()
-{
-	ClientID id = m_NextClientID.front();
-	m_NextClientID.pop();
-	return id;
-}
 
-ProjectileID ServerApplication::NextProjectileID()
-{
-	return m_NextProjectileID++;
-}
+	if (m_Rooms.size() == MAX_NUM_ROOMS) return nullptr;
 
-BlockID ServerApplication::NextBlockID()
-{
-	return m_NextBlockID++;
+	Room* room = new Room(static_cast<unsigned int>(m_Rooms.size()), m_Network);
+	m_Rooms.push_back(room);
+	return room;
 }
 
-bool ServerApplication::VerifyProjecitleShoot(const sf::Vector2f& position, const PlayerStateFrame& player)
+void ServerApplication::RemoveDepartedClients(Room* room)
 {
-	// is the game not in fight mode
-	if (m_GameState != GameState::FightMode) return false;
-	// has max projectiles been exceeded
-	if (m_Projectiles.size() == MAX_NUM_PROJECTILES) return false;
-
-	return true;
-}
+	for (auto client : room->GetDepartedClients())
+	{
+		// allow thier id to be reused later
+		m_NextClientID.push(client->GetID());
 
-bool ServerApplication::VerifyBlockPlacement(const sf::Vector2f& position, const PlayerStateFrame& player, PlayerTeam team)
-{
-	// is the game not in build mode
-	if (m_GameState != GameState::BuildMode) return false;
-	// has max blocks been exceeded
-	if (m_Blocks.size() == MAX_NUM_BLOCKS) return false;
-	// is the player close enough to the place position
-	if (Length(position - player.position) > BLOCK_PLACE_RADIUS) return false;
-	// is the block on the players own turf
-	if (!OnTeamTurf(position, team)) return false;
-	// is the block on top of any other players
-	for (auto c : m_Clients)
-		if (Length(position - c->GetCurrentPlayerState().position) < PLAYER_SIZE) return false;
-	// is the block on top of any other blocks
-	for (auto b : m_Blocks)
-		if (position == b->position) return false;
-
-	return true;
-}
+		// remove client from vector
+		auto it = m_Clients.begin();
+		for (; it != m_Clients.end(); it++)
+		{
+			if (*it == client) break;
+		}
+		m_Clients.erase(it);
+		m_ClientsByID[client->GetID()] = nullptr;
+		m_RoomsByClientID[client->GetID()] = nullptr;
+		m_Selector.remove(client->GetSocket());
 
-bool ServerApplication::OnTeamTurf(const sf::Vector2f& p, PlayerTeam team)
-{
-	switch (team)
-	{
-	case PlayerTeam::None:	return true; // always allow team-less blocks (because theyll be server spawned)
-	case PlayerTeam::Red:	return p.x < m_TurfLine && p.x > SPAWN_WIDTH;
-	case PlayerTeam::Blue:	return p.x > m_TurfLine && p.x < WORLD_WIDTH - SPAWN_WIDTH;
-	default:				return false;
+		// finally delete the client
+		delete client;
 	}
 
-	return false;
+	room->GetDepartedClients().clear();
 }
 
-void ServerApplication::CheckForBlocksAcrossTurfLine()
+ClientID ServerApplication::NextClientID()
 {
-	// any blocks across the turf line will be destroyed
-	BlocksDestroyedMessage blocksDestroyedMessage;
-	blocksDestroyedMessage.count = 0;
-
-	// iterate through all blocks
-	for (auto it = m_Blocks.begin(); it != m_Blocks.end();)
-	{
-		auto block = *it;
-
-		if (!OnTeamTurf(block->position, block->team))
-		{
-			// this block is on the wrong side
-			// add the id to the array so clients are informed to also destory this block
-			blocksDestroyedMessage.ids[blocksDestroyedMessage.count++] = block->id;
-			
-			delete block;
-			it = m_Blocks.erase(it);
-		}
-		else
-			it++;
-	}
-
-	// if any blocks were destroyed, tell all clients about it
-	if (blocksDestroyedMessage.count > 0)
-	{
-		for (auto client : m_Clients)
-			client->SendMessageTcp(MessageCode::BlocksDestroyed, blocksDestroyedMessage);
-	}
+	ClientID id = m_NextClientID.front();
+	m_NextClientID.pop();
+	return id;
 }
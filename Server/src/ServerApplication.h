@@ -3,14 +3,34 @@
 #include <SFML/Network.hpp>
 #include <vector>
 #include <queue>
+#include <algorithm>
+#include <atomic>
+#include <ostream>
 
 #include "Network/NetworkTypes.h"
-#include "GameObjects.h"
+#include "Room.h"
+#include "NetworkIOThread.h"
+#include "WorkerPool.h"
+#include "PhaseProfiler.h"
 #include "Connection.h"
 #include "Log.h"
 
 
+// counters describing how much udp traffic the server is ingesting
+struct UdpIngestStats
+{
+	unsigned int lastTickDatagrams = 0;	// datagrams drained in the most recent tick
+	unsigned int peakTickDatagrams = 0;	// most datagrams drained in a single tick
+	unsigned int totalDatagrams = 0;	// datagrams drained since the last report
+	unsigned int droppedDatagrams = 0;	// datagrams that were received but could not be dispatched
+	unsigned int spoofedDatagrams = 0;	// datagrams using the id of a client they didn't come from
+	unsigned int fullBatches = 0;		// ticks where the batch filled up and datagrams were left in the queue
+	unsigned int ticks = 0;				// ticks since the last report
+};
+
 
+// owns the sockets and every connected client
+// the matches themselves are played in rooms, which are updated in parallel every tick
 class ServerApplication
 {
 public:
@@ -18,105 +38,76 @@ public:
 	~ServerApplication();
 
 	void Run();
+	// stop running after the current tick
+	// safe to call from any thread, or from a signal handler
+	inline void Quit() { m_Quit = true; }
 
 private:
-	// process executed every iteration of the update loop
-	void SimulateGameObjects(float dt);
-	void UpdateGameState(float dt);
-
-	// begin and end the game
-	void StartGame();
-	void EndGame();
-
-	void DestroyProjectile(ProjectileState* projectile);
-	void DestroyBlock(BlockState* block);
-
-	// callbacks for messages
-	void ProcessConnect();
-	void ProcessIntroduction(Connection* client, sf::Packet& packet);
-	void ProcessDisconnect(Connection* client);
-	void ProcessUpdate(Connection* client, sf::Packet& packet);
-	void ProcessChangeTeam(Connection* client);
-	void ProcessGetServerTime(Connection* client);
-	void ProcessShootRequest(Connection* client, sf::Packet& packet);
-	void ProcessPlaceRequest(Connection* client, sf::Packet& packet);
-	void ProcessGameStartRequest(Connection* client);
-
-	Connection* FindClientWithID(ClientID id);
-
-	// send via udp
-	template<typename T>
-	void SendMessageToClientUdp(Connection* client, MessageCode code, T& message)
-	{
-		if (!client->CanSendUdp()) return;
-
-		sf::Packet packet;
-		MessageHeader header{ client->GetID(), code };
-		packet << header << message;
-
-		auto status = m_UdpSocket.send(packet, client->GetIP(), client->GetUdpPort());
-		if (status != sf::Socket::Done)
-			LOG_ERROR("Failed to send udp packet to client ID: {}", client->GetID());
-	}
-	void SendMessageToClientUdp(Connection* client, MessageCode code)
-	{
-		if (!client->CanSendUdp()) return;
-
-		sf::Packet packet;
-		MessageHeader header{ client->GetID(), code };
-		packet << header;
-
-		auto status = m_UdpSocket.send(packet, client->GetIP(), client->GetUdpPort());
-		if (status != sf::Socket::Done)
-			LOG_ERROR("Failed to send udp packet to client ID: {}", client->GetID());
-	}
+	// how long the main loop can sleep for before it next has work to do
+	float TimeUntilNextEvent() const;
+
+	// udp ingest: take a batch of the datagrams the network thread has received, and hand each one to the room its client is in
+	void RouteUdpBatch();
+	void ReportStats(float dt);
+	// every client's traffic and connection quality
+	void LogConnectionStats() const;
+	// as a json array, with each message code's traffic as [packets in, bytes in, packets out, bytes out]
+	void WriteConnectionStatsJson(std::ostream& out) const;
+
+	// a client has connected, put them in a room
+	void ProcessConnect(Room* room);
+	// the first room with space for another player, opening a new one if they are all full
+	// nullptr if there are no more rooms to open
+	Room* FindRoomForNewClient();
+	// clean up the clients that left their rooms during the last update
+	void RemoveDepartedClients(Room* room);
+
+	// constant time, every possible id has a slot in m_ClientsByID
+	inline Connection* FindClientWithID(ClientID id) const { return m_ClientsByID[id]; }
 
 	// get the next id in the queue
 	ClientID NextClientID();
-	ProjectileID NextProjectileID();
-	BlockID NextBlockID();
-
-	bool VerifyProjecitleShoot(const sf::Vector2f& position, const PlayerStateFrame& player);
-	bool VerifyBlockPlacement(const sf::Vector2f& position, const PlayerStateFrame& player, PlayerTeam team);
-
-	bool OnTeamTurf(const sf::Vector2f& p, PlayerTeam team);
-	
-	void CheckForBlocksAcrossTurfLine();
 
 private:
 	// the servers sockets
 	sf::TcpListener m_ListenSocket;
 	sf::UdpSocket m_UdpSocket;
-	
-	// all connected clients
+	// waits for any of the servers sockets to become readable
+	sf::SocketSelector m_Selector;
+
+	// datagrams taken from the network thread this tick
+	size_t m_UdpBatchSize = 0;
+	UdpIngestStats m_UdpStats;
+	// most clients backlogged at once across the whole server, counted after every tick
+	unsigned int m_PeakBackloggedClients = 0;
+
+	// all connected clients, in every room
 	std::vector<Connection*> m_Clients;
+	// the same clients indexed by id, nullptr where no client has that id, along with the room each is in
+	Connection* m_ClientsByID[INVALID_CLIENT_ID + 1] = {};
+	Room* m_RoomsByClientID[INVALID_CLIENT_ID + 1] = {};
 	Connection* m_NewConnection = nullptr;
 
 	// a queue is used to recycle client ID's
+	// ids are unique across every room, so that a datagram's header is enough to find the room it is for
 	std::queue<ClientID> m_NextClientID;
-	ProjectileID m_NextProjectileID = 0;
-	BlockID m_NextBlockID = 0;
+
+	// the matches being played
+	std::vector<Room*> m_Rooms;
+	// updates the rooms in parallel
+	WorkerPool m_Workers;
 
 	// clock and timers
 	sf::Clock m_ServerClock;
-	float m_SimulationTime = 0.0f;
-	float m_UpdateTimer = 0.0f;
-	float m_PingTimer = 0.0f;
-
-	// gameplay
-	unsigned int m_RedTeamPlayerCount = 0, m_BlueTeamPlayerCount = 0;
-
-	GameState m_GameState = GameState::Lobby;
-	float m_BuildModeDuration = INITIAL_BUILD_MODE_DURATION;
-	float m_FightModeDuration = INITIAL_FIGHT_MODE_DURATION;
-	float m_StateTimer = 0.0f;
-	float m_StateDuration = 0.0f;
-	int m_RoundNum = 0;
-
-	// turf line starts at halfway
-	float m_TurfLine = 0.5f * WORLD_WIDTH;
-
-	// objects simulated by the server
-	std::vector<ProjectileState*> m_Projectiles;
-	std::vector<BlockState*> m_Blocks;
+	float m_ServerTime = 0.0f; // real time, used for measuring latency
+	float m_StatsTimer = 0.0f;
+	std::atomic<bool> m_Quit{ false };
+
+	// times the phases of the main loop, the rooms time their own
+	PhaseProfiler m_Profiler;
+	// everything reported in the last window, kept as a member as it is too big to want on the stack
+	PhaseProfiler m_ReportProfiler;
+
+	// reads and writes the udp socket, so that network load doesn't hold up the rooms
+	NetworkIOThread m_Network{ m_UdpSocket, m_ServerClock };
 };
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+
+// a fixed size queue between exactly one producer thread and one consumer thread, with no locks
+// items are constructed up front and reused, so that anything they allocate is kept between uses
+// the producer fills a slot in place and then publishes it, the consumer can look at many items before releasing them
+template<typename T>
+class SpscRing
+{
+public:
+	// the capacity is rounded up to a power of 2
+	explicit SpscRing(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		m_Slots.resize(size);
+		m_Mask = size - 1;
+	}
+
+	inline size_t Capacity() const { return m_Slots.size(); }
+
+	// producer: the next free slot, or nullptr if the queue is full
+	// the slot isn't visible to the consumer until it is committed
+	T* BeginPush()
+	{
+		size_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) == m_Slots.size()) return nullptr;
+		return &m_Slots[head & m_Mask];
+	}
+	void CommitPush()
+	{
+		m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// consumer: how many items are waiting, and the i'th one from the front
+	inline size_t Available() const { return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_relaxed); }
+	inline T& Peek(size_t i) { return m_Slots[(m_Tail.load(std::memory_order_relaxed) + i) & m_Mask]; }
+	// hand the front count items back to the producer
+	void Pop(size_t count)
+	{
+		assert(count <= Available() && "Popping more items than are queued!");
+		m_Tail.store(m_Tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+	}
+
+private:
+	std::vector<T> m_Slots;
+	size_t m_Mask = 0;
+
+	// total items ever pushed and popped, the difference is how many are queued
+	// padded onto separate cache lines so that the two threads aren't fighting over the same one
+	// (padding rather than alignas, the ring is allocated on the heap which doesn't respect over-alignment before c++17)
+	char m_PaddingBefore[64] = {};
+	std::atomic<size_t> m_Head{ 0 };
+	char m_PaddingBetween[64] = {};
+	std::atomic<size_t> m_Tail{ 0 };
+};
@@ -0,0 +1,84 @@
+#include "WorkerPool.h"
+
+#include "Trace.h"
+
+
+WorkerPool::WorkerPool(unsigned int numThreads)
+{
+	m_Threads.reserve(numThreads);
+	for (unsigned int i = 0; i < numThreads; i++)
+		m_Threads.emplace_back(&WorkerPool::WorkerMain, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_BatchReady.notify_all();
+
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+void WorkerPool::Run(size_t count, const std::function<void(size_t)>& job)
+{
+	if (count == 0) return;
+
+	// not worth waking anyone up for a single job
+	if (m_Threads.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Job = &job;
+		m_JobCount = count;
+		m_NextJob = 0;
+		m_BusyWorkers = static_cast<unsigned int>(m_Threads.size());
+		m_Batch++;
+	}
+	m_BatchReady.notify_all();
+
+	// help out rather than sitting idle
+	WorkThroughBatch();
+
+	// wait for the jobs still running on other threads
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_BatchDone.wait(lock, [this] { return m_BusyWorkers == 0; });
+	m_Job = nullptr;
+}
+
+void WorkerPool::WorkerMain()
+{
+	TRACE_THREAD_NAME("Worker");
+
+	unsigned int lastBatch = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_BatchReady.wait(lock, [&] { return m_Quit || m_Batch != lastBatch; });
+			if (m_Quit) return;
+			lastBatch = m_Batch;
+		}
+
+		WorkThroughBatch();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (--m_BusyWorkers == 0)
+			m_BatchDone.notify_one();
+	}
+}
+
+void WorkerPool::WorkThroughBatch()
+{
+	// every thread takes the next job that nobody has started yet until there are none left
+	for (size_t i = m_NextJob++; i < m_JobCount; i = m_NextJob++)
+		(*m_Job)(i);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+
+// a fixed set of threads that work through a batch of independent jobs together
+// the thread that hands out the batch works on it too, and only returns once every job has finished
+class WorkerPool
+{
+public:
+	// numThreads is the number of extra threads to start, 0 runs every job on the calling thread
+	explicit WorkerPool(unsigned int numThreads);
+	~WorkerPool();
+
+	// threads working on a batch, including the caller
+	inline unsigned int NumThreads() const { return static_cast<unsigned int>(m_Threads.size()) + 1; }
+
+	// call job(i) for every i in [0, count) and wait for them all to complete
+	// jobs are taken in order, but can run on any thread and in parallel with each other
+	void Run(size_t count, const std::function<void(size_t)>& job);
+
+private:
+	void WorkerMain();
+	void WorkThroughBatch();
+
+private:
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_BatchReady;
+	std::condition_variable m_BatchDone;
+
+	// the current batch
+	const std::function<void(size_t)>* m_Job = nullptr;
+	size_t m_JobCount = 0;
+	std::atomic<size_t> m_NextJob{ 0 };
+	// incremented every batch so that workers can tell a new batch from a spurious wake up
+	unsigned int m_Batch = 0;
+	// workers that haven't finished with the current batch yet
+	unsigned int m_BusyWorkers = 0;
+	bool m_Quit = false;
+};